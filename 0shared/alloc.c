@@ -0,0 +1,114 @@
+/*--------------------------------------------------------------------*/
+/* alloc.c                                                            */
+/* Author: Kok Wei Pua and Cherie Jiraphanphong                       */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+/*
+  The allocator is an AO with the following state variables, all
+  NULL while it is the C library's:
+*/
+
+/* 1. the function that allocates a block */
+static void *(*pfAllocate)(size_t ulSize, void *pvContext);
+/* 2. the function that resizes a block */
+static void *(*pfReallocate)(void *pvBlock, size_t ulSize,
+                             void *pvContext);
+/* 3. the function that frees a block, or NULL if the allocator
+      releases its memory all at once */
+static void (*pfRelease)(void *pvBlock, void *pvContext);
+/* 4. the extra argument to each of the three */
+static void *pvAllocContext;
+
+/*--------------------------------------------------------------------*/
+
+void Alloc_set(void *(*pfAlloc)(size_t ulSize, void *pvContext),
+               void *(*pfRealloc)(void *pvBlock, size_t ulSize,
+                                  void *pvContext),
+               void (*pfFree)(void *pvBlock, void *pvContext),
+               void *pvContext) {
+   if(pfAlloc == NULL) {
+      pfAllocate = NULL;
+      pfReallocate = NULL;
+      pfRelease = NULL;
+      pvAllocContext = NULL;
+      return;
+   }
+
+   assert(pfRealloc != NULL);
+
+   pfAllocate = pfAlloc;
+   pfReallocate = pfRealloc;
+   pfRelease = pfFree;
+   pvAllocContext = pvContext;
+}
+
+/*--------------------------------------------------------------------*/
+
+boolean Alloc_isDefault(void) {
+   return (boolean) (pfAllocate == NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+boolean Alloc_isBulk(void) {
+   return (boolean) (pfAllocate != NULL && pfRelease == NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Alloc_malloc(size_t ulSize) {
+   if(pfAllocate == NULL)
+      return malloc(ulSize);
+
+   /* like malloc(0), return a block that can be freed */
+   if(ulSize == 0)
+      ulSize = 1;
+   return (*pfAllocate)(ulSize, pvAllocContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Alloc_calloc(size_t ulCount, size_t ulSize) {
+   void *pvBlock;
+
+   if(pfAllocate == NULL)
+      return calloc(ulCount, ulSize);
+
+   if(ulSize != 0 && ulCount > (size_t)-1 / ulSize)
+      return NULL;
+   pvBlock = Alloc_malloc(ulCount * ulSize);
+   if(pvBlock != NULL)
+      memset(pvBlock, 0, ulCount * ulSize);
+   return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Alloc_realloc(void *pvBlock, size_t ulSize) {
+   if(pfAllocate == NULL)
+      return realloc(pvBlock, ulSize);
+
+   if(pvBlock == NULL)
+      return Alloc_malloc(ulSize);
+   if(ulSize == 0)
+      ulSize = 1;
+   return (*pfReallocate)(pvBlock, ulSize, pvAllocContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Alloc_free(void *pvBlock) {
+   if(pfAllocate == NULL) {
+      free(pvBlock);
+      return;
+   }
+
+   if(pvBlock != NULL && pfRelease != NULL)
+      (*pfRelease)(pvBlock, pvAllocContext);
+}
@@ -0,0 +1,57 @@
+/*--------------------------------------------------------------------*/
+/* alloc.h                                                            */
+/* Author: Kok Wei Pua and Cherie Jiraphanphong                       */
+/*--------------------------------------------------------------------*/
+
+#ifndef ALLOC_INCLUDED
+#define ALLOC_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  The allocator is a single, process-wide set of functions through
+  which the dynamic array, path, intern, and tree modules obtain and
+  release all of the memory that they keep. It is the C library's
+  malloc, realloc, and free unless the client installs its own, such
+  as an arena that releases a whole tree at once. Memory that a module
+  hands over to its client, like the string from FT_toString, still
+  comes from malloc, so that the client can always free it.
+*/
+
+/*
+  Makes pfAlloc, pfRealloc, and pfFree the allocator, each of which is
+  passed pvContext as its last argument, or restores the C library's
+  allocator if pfAlloc is NULL. pfAlloc and pfRealloc must behave like
+  malloc and realloc, except that they are never called with a size of
+  0 or (in the case of pfRealloc) a NULL block. pfFree may be NULL if
+  the allocator releases its memory all at once instead of block by
+  block, in which case the modules also skip their own per-block
+  cleanup where they can. The allocator must only be changed while no
+  memory obtained from the current one remains in use.
+*/
+void Alloc_set(void *(*pfAlloc)(size_t ulSize, void *pvContext),
+               void *(*pfRealloc)(void *pvBlock, size_t ulSize,
+                                  void *pvContext),
+               void (*pfFree)(void *pvBlock, void *pvContext),
+               void *pvContext);
+
+/* Returns TRUE if the allocator is the C library's, FALSE otherwise. */
+boolean Alloc_isDefault(void);
+
+/*
+  Returns TRUE if the allocator releases its memory all at once, so
+  that freeing individual blocks is unnecessary, and FALSE otherwise.
+*/
+boolean Alloc_isBulk(void);
+
+/*
+  Behave as malloc, calloc, realloc, and free do, but using the
+  allocator. Alloc_free does nothing if the allocator is bulk.
+*/
+void *Alloc_malloc(size_t ulSize);
+void *Alloc_calloc(size_t ulCount, size_t ulSize);
+void *Alloc_realloc(void *pvBlock, size_t ulSize);
+void Alloc_free(void *pvBlock);
+
+#endif
@@ -3,9 +3,21 @@
 /* Author: Bob Dondero                                                */
 /*--------------------------------------------------------------------*/
 
+/* mremap is a Linux extension. */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
 #include "dynarray.h"
+#include "alloc.h"
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 /*--------------------------------------------------------------------*/
 
@@ -30,6 +42,10 @@ struct DynArray
 
    /* The array that underlies the DynArray. */
    const void **ppvArray;
+
+   /* 1 (TRUE) if ppvArray is a memory mapping rather than memory
+      from the allocator. */
+   int iMapped;
 };
 
 /*--------------------------------------------------------------------*/
@@ -51,22 +67,151 @@ static int DynArray_isValid(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
-/* Increase the physical length of oDynArray.  Return 1 (TRUE) if
-   successful and 0 (FALSE) if insufficient memory is available. */
+#if defined(__linux__)
 
-static int DynArray_grow(DynArray_T oDynArray)
+/* The size in bytes above which the array that underlies a DynArray
+   is a memory mapping of its own, which mremap can grow by remapping
+   pages instead of copying them.  Only the C library's allocator is
+   bypassed this way; a client's allocator gets every array. */
+
+static const size_t MAP_THRESHOLD = 1048576;
+
+/*--------------------------------------------------------------------*/
+
+/* Return the size in bytes of a mapping that holds uLength
+   elements, which is a whole number of pages. */
+
+static size_t DynArray_mappingSize(size_t uLength)
 {
-   const size_t GROWTH_FACTOR = 2;
+   size_t uPageSize;
+   size_t uSize;
 
-   size_t uNewLength;
+   uPageSize = (size_t)sysconf(_SC_PAGESIZE);
+   uSize = sizeof(void*) * uLength;
+   return (uSize + uPageSize - 1) / uPageSize * uPageSize;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Give oDynArray a new underlying array of at least uPhysLength
+   zeroed elements, ignoring any array it has, and set its physical
+   length accordingly.  Return 1 (TRUE) if successful and 0 (FALSE) if
+   insufficient memory is available. */
+
+static int DynArray_allocArray(DynArray_T oDynArray,
+                               size_t uPhysLength)
+{
+#if defined(__linux__)
+   size_t uSize;
+   void *pvMapping;
+#endif
+
+   assert(oDynArray != NULL);
+
+#if defined(__linux__)
+   if (Alloc_isDefault() && sizeof(void*) * uPhysLength > MAP_THRESHOLD)
+   {
+      /* Anonymous mappings are zeroed, and any slack at the end of
+         the last page becomes more elements. */
+      uSize = DynArray_mappingSize(uPhysLength);
+      pvMapping = mmap(NULL, uSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (pvMapping == MAP_FAILED)
+         return 0;
+      oDynArray->ppvArray = (const void**)pvMapping;
+      oDynArray->uPhysLength = uSize / sizeof(void*);
+      oDynArray->iMapped = 1;
+      return 1;
+   }
+#endif
+
+   oDynArray->ppvArray =
+      (const void**)Alloc_calloc(uPhysLength, sizeof(void*));
+   if (oDynArray->ppvArray == NULL)
+      return 0;
+   oDynArray->uPhysLength = uPhysLength;
+   oDynArray->iMapped = 0;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the array that underlies oDynArray. */
+
+static void DynArray_freeArray(DynArray_T oDynArray)
+{
+   assert(oDynArray != NULL);
+
+#if defined(__linux__)
+   if (oDynArray->iMapped)
+   {
+      (void)munmap((void*)oDynArray->ppvArray,
+                   DynArray_mappingSize(oDynArray->uPhysLength));
+      return;
+   }
+#endif
+
+   Alloc_free(oDynArray->ppvArray);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Change the physical length of oDynArray to at least uNewLength,
+   keeping its elements.  Return 1 (TRUE) if successful and 0 (FALSE)
+   if insufficient memory is available. */
+
+static int DynArray_resizeArray(DynArray_T oDynArray,
+                                size_t uNewLength)
+{
    const void **ppvNewArray;
+#if defined(__linux__)
+   struct DynArray sNew;
+   size_t uSize;
+   void *pvMapping;
+#endif
 
    assert(oDynArray != NULL);
+   assert(uNewLength >= oDynArray->uLength);
+
+#if defined(__linux__)
+   /* A mapping grows or shrinks in place where it can, and otherwise
+      moves by remapping its pages, so its elements are never
+      copied. */
+   if (oDynArray->iMapped &&
+       sizeof(void*) * uNewLength > MAP_THRESHOLD)
+   {
+      uSize = DynArray_mappingSize(uNewLength);
+      pvMapping = mremap((void*)oDynArray->ppvArray,
+                         DynArray_mappingSize(oDynArray->uPhysLength),
+                         uSize, MREMAP_MAYMOVE);
+      if (pvMapping == MAP_FAILED)
+         return 0;
+      oDynArray->ppvArray = (const void**)pvMapping;
+      oDynArray->uPhysLength = uSize / sizeof(void*);
+      return 1;
+   }
 
-   uNewLength = GROWTH_FACTOR * oDynArray->uPhysLength;
+   /* Moving into or out of a mapping copies the elements once. */
+   if (oDynArray->iMapped ||
+       (Alloc_isDefault() &&
+        sizeof(void*) * uNewLength > MAP_THRESHOLD))
+   {
+      if (! DynArray_allocArray(&sNew, uNewLength))
+         return 0;
+      memcpy((void*)sNew.ppvArray, (void*)oDynArray->ppvArray,
+             sizeof(void*) * oDynArray->uLength);
+      DynArray_freeArray(oDynArray);
+      oDynArray->ppvArray = sNew.ppvArray;
+      oDynArray->uPhysLength = sNew.uPhysLength;
+      oDynArray->iMapped = sNew.iMapped;
+      return 1;
+   }
+#endif
 
    ppvNewArray = (const void**)
-      realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
+      Alloc_realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
    if (ppvNewArray == NULL)
       return 0;
 
@@ -77,25 +222,52 @@ static int DynArray_grow(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
+/* Increase the physical length of oDynArray to at least uMinLength,
+   and at least by GROWTH_FACTOR.  Return 1 (TRUE) if successful and
+   0 (FALSE) if insufficient memory is available. */
+
+static int DynArray_reserve(DynArray_T oDynArray, size_t uMinLength)
+{
+   const size_t GROWTH_FACTOR = 2;
+
+   size_t uNewLength;
+
+   assert(oDynArray != NULL);
+
+   uNewLength = GROWTH_FACTOR * oDynArray->uPhysLength;
+   if (uNewLength < uMinLength)
+      uNewLength = uMinLength;
+
+   return DynArray_resizeArray(oDynArray, uNewLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Increase the physical length of oDynArray.  Return 1 (TRUE) if
+   successful and 0 (FALSE) if insufficient memory is available. */
+
+static int DynArray_grow(DynArray_T oDynArray)
+{
+   assert(oDynArray != NULL);
+
+   return DynArray_reserve(oDynArray, oDynArray->uPhysLength + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
 DynArray_T DynArray_new(size_t uLength)
 {
    DynArray_T oDynArray;
 
-   oDynArray = (struct DynArray*)malloc(sizeof(struct DynArray));
+   oDynArray = (struct DynArray*)Alloc_malloc(sizeof(struct DynArray));
    if (oDynArray == NULL)
       return NULL;
 
    oDynArray->uLength = uLength;
-   if (uLength > MIN_PHYS_LENGTH)
-      oDynArray->uPhysLength = uLength;
-   else
-      oDynArray->uPhysLength = MIN_PHYS_LENGTH;
-
-   oDynArray->ppvArray =
-      (const void**)calloc(oDynArray->uPhysLength, sizeof(void*));
-   if (oDynArray->ppvArray == NULL)
+   if (! DynArray_allocArray(oDynArray, (uLength > MIN_PHYS_LENGTH) ?
+                             uLength : MIN_PHYS_LENGTH))
    {
-      free(oDynArray);
+      Alloc_free(oDynArray);
       return NULL;
    }
 
@@ -109,8 +281,8 @@ void DynArray_free(DynArray_T oDynArray)
    assert(oDynArray != NULL);
    assert(DynArray_isValid(oDynArray));
 
-   free(oDynArray->ppvArray);
-   free(oDynArray);
+   DynArray_freeArray(oDynArray);
+   Alloc_free(oDynArray);
 }
 
 /*--------------------------------------------------------------------*/
@@ -223,215 +395,1307 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 
 /*--------------------------------------------------------------------*/
 
-void DynArray_toArray(DynArray_T oDynArray, void **ppvArray)
+int DynArray_insertRange(DynArray_T oDynArray, size_t uIndex,
+                         const void * const *ppvElements, size_t uCount)
 {
-   size_t u;
+   assert(oDynArray != NULL);
+   assert(uIndex <= oDynArray->uLength);
+   assert(ppvElements != NULL || uCount == 0);
+   assert(DynArray_isValid(oDynArray));
+
+   if (uCount == 0)
+      return 1;
+
+   if (oDynArray->uPhysLength - oDynArray->uLength < uCount)
+      if (! DynArray_reserve(oDynArray, oDynArray->uLength + uCount))
+         return 0;
+
+   memmove(&oDynArray->ppvArray[uIndex + uCount],
+           &oDynArray->ppvArray[uIndex],
+           sizeof(void*) * (oDynArray->uLength - uIndex));
+   memcpy(&oDynArray->ppvArray[uIndex], ppvElements,
+          sizeof(void*) * uCount);
+   oDynArray->uLength += uCount;
+
+   assert(DynArray_isValid(oDynArray));
+
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
 
+int DynArray_appendArray(DynArray_T oDynArray,
+                         const void * const *ppvElements, size_t uCount)
+{
    assert(oDynArray != NULL);
-   assert(ppvArray != NULL);
+   assert(ppvElements != NULL || uCount == 0);
+
+   return DynArray_insertRange(oDynArray, oDynArray->uLength,
+                               ppvElements, uCount);
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_removeRange(DynArray_T oDynArray, size_t uIndex,
+                          size_t uCount)
+{
+   assert(oDynArray != NULL);
+   assert(uIndex <= oDynArray->uLength);
+   assert(uCount <= oDynArray->uLength - uIndex);
    assert(DynArray_isValid(oDynArray));
 
-   for (u = 0; u < oDynArray->uLength; u++)
-      ppvArray[u] = (void*)oDynArray->ppvArray[u];
+   memmove(&oDynArray->ppvArray[uIndex],
+           &oDynArray->ppvArray[uIndex + uCount],
+           sizeof(void*) * (oDynArray->uLength - uIndex - uCount));
+   oDynArray->uLength -= uCount;
+
+   assert(DynArray_isValid(oDynArray));
 }
 
 /*--------------------------------------------------------------------*/
 
-void DynArray_map(DynArray_T oDynArray,
-                  void (*pfApply)(void *pvElement, void *pvExtra),
-                  const void *pvExtra)
+void DynArray_truncate(DynArray_T oDynArray, size_t uLength)
+{
+   assert(oDynArray != NULL);
+   assert(uLength <= oDynArray->uLength);
+   assert(DynArray_isValid(oDynArray));
+
+   oDynArray->uLength = uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DynArray_shrink(DynArray_T oDynArray)
+{
+   const size_t SHRINK_FACTOR = 4;
+
+   size_t uOldLength;
+   size_t uNewLength;
+
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   /* Shrink only a mostly empty array, and leave it room to grow, so
+      that an array whose length goes up and down is not reallocated
+      each time. */
+   if (oDynArray->uLength > oDynArray->uPhysLength / SHRINK_FACTOR)
+      return 0;
+   uNewLength = 2 * oDynArray->uLength;
+   if (uNewLength < MIN_PHYS_LENGTH)
+      uNewLength = MIN_PHYS_LENGTH;
+   if (uNewLength >= oDynArray->uPhysLength)
+      return 0;
+
+   uOldLength = oDynArray->uPhysLength;
+   if (! DynArray_resizeArray(oDynArray, uNewLength))
+      return 0;
+   if (oDynArray->uPhysLength >= uOldLength)
+      return 0;
+
+   assert(DynArray_isValid(oDynArray));
+
+   return sizeof(void*) * (uOldLength - oDynArray->uPhysLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_toArray(DynArray_T oDynArray, void **ppvArray)
 {
    size_t u;
 
    assert(oDynArray != NULL);
-   assert(pfApply != NULL);
+   assert(ppvArray != NULL);
    assert(DynArray_isValid(oDynArray));
 
    for (u = 0; u < oDynArray->uLength; u++)
-      (*pfApply)((void*)oDynArray->ppvArray[u], (void*)pvExtra);
+      ppvArray[u] = (void*)oDynArray->ppvArray[u];
 }
 
 /*--------------------------------------------------------------------*/
 
-/* Sort the array of elements that resides in memory at
-   addresses ppvLo...ppvHi in ascending order, as determined
-   by *pfCompare.
-   *pfCompare must return <0, 0, or >0 depending upon whether
-   *pvElement1 is less than, equal to, or greater than *pvElement2,
-   respectively. */
+/* Return the index of the first element of the uRun'th of uRuns runs
+   of nearly equal length into which an array of uLength elements is
+   divided.  uRun may be uRuns, giving uLength. */
 
-static void DynArray_qsort(
-   const void **ppvLo,
-   const void **ppvHi,
-   int (*pfCompare) (const void *pvElement1, const void *pvElement2))
+static size_t DynArray_runStart(size_t uLength, size_t uRun,
+                                size_t uRuns)
 {
-   /* This function implements a variation of the quicksort algorithm
-      shown in the book "Algorithms + Data Structures = Programs" by
-      Niklaus Wirth. */
+   assert(uRun <= uRuns);
+   assert(uRuns > 0);
 
-   /* This function uses pointers instead of indices to avoid
-      complications with using unsigned integers as array indices. */
+   return uLength / uRuns * uRun + uLength % uRuns * uRun / uRuns;
+}
 
-   const void **ppvRight;
-   const void **ppvLeft;
-   const void *pvPivot;
-   const void *pvTemp;
+/*--------------------------------------------------------------------*/
 
-   assert(ppvLo != NULL);
-   assert(ppvHi != NULL);
-   assert(pfCompare != NULL);
+/* DynArray_mapParallel and DynArray_sortParallel hand their work to a
+   pool of threads that is started the first time either is called,
+   with one thread per processor, counting the calling thread, which
+   works alongside the pool.  The threads then wait for more work
+   until the process exits, so that each call does not pay to create
+   and join threads.  Work is given to the pool as a batch of jobs,
+   numbered from 0, which the threads take in turn. */
 
-   ppvRight = ppvLo;
-   ppvLeft = ppvHi;
-   pvPivot = *(ppvLo + ((ppvHi - ppvLo) / 2));
+/* The most threads that the pool has, counting the calling thread. */
 
-   while (ppvRight <= ppvLeft)
-   {
-      while ((*pfCompare)(*ppvRight, pvPivot) < 0)
-         ppvRight++;
-      while ((*pfCompare)(pvPivot, *ppvLeft) < 0)
-         ppvLeft--;
-      if (ppvRight <= ppvLeft)
-      {
-         /* Swap *ppvRight and *ppvLeft. */
-         pvTemp = *ppvRight;
-         *ppvRight = *ppvLeft;
-         *ppvLeft = pvTemp;
+enum {MAX_POOL_THREADS = 64};
 
-         ppvRight++;
-         ppvLeft--;
-      }
+/* The pool is an AO with the following state variables, all guarded
+   by sPoolLock: */
+
+/* 1. the lock */
+static pthread_mutex_t sPoolLock = PTHREAD_MUTEX_INITIALIZER;
+/* 2. signalled when a batch is given to the pool */
+static pthread_cond_t sPoolWork = PTHREAD_COND_INITIALIZER;
+/* 3. signalled when the last job of a batch is finished */
+static pthread_cond_t sPoolDone = PTHREAD_COND_INITIALIZER;
+/* 4. the number of threads, counting the calling thread, once the
+      pool is started */
+static size_t uPoolThreads;
+/* 5. the function that does each job of the batch, and the batch,
+      which is passed to it along with the job's number */
+static void (*pfPoolRun)(void *pvBatch, size_t uJob);
+static void *pvPoolBatch;
+/* 6. the number of jobs in the batch, the number of the next job to
+      be taken, and the number of jobs not yet finished */
+static size_t uPoolJobs;
+static size_t uPoolNextJob;
+static size_t uPoolUnfinished;
+
+/* Held by the one caller whose batch the pool is doing. */
+
+static pthread_mutex_t sPoolBatchLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Ensures that the pool is started only once. */
+
+static pthread_once_t sPoolOnce = PTHREAD_ONCE_INIT;
+
+/*--------------------------------------------------------------------*/
+
+/* Take and do jobs of the pool's batches forever.  This is the start
+   routine of each thread of the pool. */
+
+static void *DynArray_poolWorker(void *pvUnused)
+{
+   void (*pfRun)(void *pvBatch, size_t uJob);
+   void *pvBatch;
+   size_t uJob;
+
+   (void)pvUnused;
+
+   (void)pthread_mutex_lock(&sPoolLock);
+   for (;;)
+   {
+      while (uPoolNextJob >= uPoolJobs)
+         (void)pthread_cond_wait(&sPoolWork, &sPoolLock);
+      uJob = uPoolNextJob++;
+      pfRun = pfPoolRun;
+      pvBatch = pvPoolBatch;
+      (void)pthread_mutex_unlock(&sPoolLock);
+
+      (*pfRun)(pvBatch, uJob);
+
+      (void)pthread_mutex_lock(&sPoolLock);
+      if (--uPoolUnfinished == 0)
+         (void)pthread_cond_signal(&sPoolDone);
    }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Start the pool's threads, one fewer than the number of processors
+   online, as far as they can be created. */
 
-   if (ppvLo < ppvLeft)
-      DynArray_qsort(ppvLo, ppvLeft, pfCompare);
-   if (ppvRight < ppvHi)
-      DynArray_qsort(ppvRight, ppvHi, pfCompare);
+static void DynArray_startPool(void)
+{
+   pthread_t thread;
+   long lProcessors = 1;
+
+#if defined(_SC_NPROCESSORS_ONLN)
+   lProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+   if (lProcessors < 1)
+      lProcessors = 1;
+   if (lProcessors > MAX_POOL_THREADS)
+      lProcessors = MAX_POOL_THREADS;
+
+   uPoolThreads = 1;
+   while (uPoolThreads < (size_t)lProcessors)
+   {
+      if (pthread_create(&thread, NULL, DynArray_poolWorker, NULL) != 0)
+         break;
+      (void)pthread_detach(thread);
+      uPoolThreads++;
+   }
 }
 
 /*--------------------------------------------------------------------*/
 
-void DynArray_sort(DynArray_T oDynArray,
-                   int (*pfCompare)(const void *pvElement1,
-                                    const void *pvElement2))
+/* Call (*pfRun)(pvBatch, u) for each u from 0 to uJobs-1, using the
+   pool's threads as well as the calling thread, and return once all
+   of the calls have returned.  If the pool is busy with another
+   caller's batch, including that of a job calling this function, the
+   calling thread does every job itself instead. */
+
+static void DynArray_runBatch(void (*pfRun)(void *pvBatch, size_t uJob),
+                              void *pvBatch, size_t uJobs)
 {
-   assert(oDynArray != NULL);
-   assert(pfCompare != NULL);
-   assert(DynArray_isValid(oDynArray));
+   size_t uJob;
+
+   assert(pfRun != NULL);
 
-   if (oDynArray->uLength < 2)
+   (void)pthread_once(&sPoolOnce, DynArray_startPool);
+
+   if (uPoolThreads < 2 || uJobs < 2 ||
+       pthread_mutex_trylock(&sPoolBatchLock) != 0)
+   {
+      for (uJob = 0; uJob < uJobs; uJob++)
+         (*pfRun)(pvBatch, uJob);
       return;
+   }
 
-   DynArray_qsort(
-      &oDynArray->ppvArray[0],
-      &oDynArray->ppvArray[oDynArray->uLength-1],
-      pfCompare);
+   (void)pthread_mutex_lock(&sPoolLock);
+   pfPoolRun = pfRun;
+   pvPoolBatch = pvBatch;
+   uPoolJobs = uJobs;
+   uPoolNextJob = 0;
+   uPoolUnfinished = uJobs;
+   (void)pthread_cond_broadcast(&sPoolWork);
+
+   /* Take jobs like any thread of the pool, and then wait for the
+      ones that other threads took. */
+   while (uPoolNextJob < uPoolJobs)
+   {
+      uJob = uPoolNextJob++;
+      (void)pthread_mutex_unlock(&sPoolLock);
+      (*pfRun)(pvBatch, uJob);
+      (void)pthread_mutex_lock(&sPoolLock);
+      uPoolUnfinished--;
+   }
+   while (uPoolUnfinished > 0)
+      (void)pthread_cond_wait(&sPoolDone, &sPoolLock);
+   uPoolJobs = 0;
+   uPoolNextJob = 0;
+   (void)pthread_mutex_unlock(&sPoolLock);
 
-   assert(DynArray_isValid(oDynArray));
+   (void)pthread_mutex_unlock(&sPoolBatchLock);
 }
 
 /*--------------------------------------------------------------------*/
 
-int DynArray_search(DynArray_T oDynArray,
-                    void *pvSoughtElement,
-                    size_t *puIndex,
-                    int (*pfCompare)(const void *pvElement1,
-                                     const void *pvElement2))
+size_t DynArray_getParallelism(void)
+{
+   (void)pthread_once(&sPoolOnce, DynArray_startPool);
+   return uPoolThreads;
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_map(DynArray_T oDynArray,
+                  void (*pfApply)(void *pvElement, void *pvExtra),
+                  const void *pvExtra)
 {
    size_t u;
 
    assert(oDynArray != NULL);
-   assert(puIndex != NULL);
-   assert(pfCompare != NULL);
+   assert(pfApply != NULL);
    assert(DynArray_isValid(oDynArray));
 
    for (u = 0; u < oDynArray->uLength; u++)
-      if ((*pfCompare)(oDynArray->ppvArray[u], pvSoughtElement) == 0)
-      {
-         *puIndex = u;
-         return 1;
-      }
-   return 0;
+      (*pfApply)((void*)oDynArray->ppvArray[u], (void*)pvExtra);
 }
 
+/*--------------------------------------------------------------------*/
 
+/* The fewest elements per run for which DynArray_mapParallel uses
+   the pool; shorter arrays are mapped serially. */
 
-/*--------------------------------------------------------------------*/
+static const size_t PARALLEL_MAP_LENGTH = 4096;
 
-/* Binary search the array of elements that resides in memory at
-   addresses ppvLo...ppvHi for pvSoughtElement.
-   *pfCompare must return <0, 0, or >0 depending upon whether
-   *pvElement1 is less than, equal to, or greater than *pvElement2,
-   respectively. If pvSoughtElement is not found, *pppvInsert is set to
-   point at the memory location where it would be placed if inserted.
-*/
+/* The work of one call of DynArray_mapParallel, whose uRuns runs are
+   the jobs of a batch. */
 
-static const void **DynArray_bsearchHelp(
-   void *pvSoughtElement,
-   const void **ppvLo,
-   const void **ppvHi,
-   int (*pfCompare)(const void *pvElement1, const void *pvElement2),
-   const void*** pppvInsert)
+struct DynArrayMapBatch
 {
-   /* This function uses pointers instead of indices to avoid
-      complications with using unsigned integers as array indices. */
+   /* The array to apply the function to. */
+   DynArray_T oDynArray;
 
-   const void **ppvMid;
-   int iCompare;
+   /* The number of runs. */
+   size_t uRuns;
 
-   assert(ppvLo != NULL);
-   assert(ppvHi != NULL);
-   assert(pfCompare != NULL);
-   assert(pppvInsert != NULL);
+   /* The function, and the extra arguments of the runs, each of size
+      uExtraSize. */
+   void (*pfApply)(void *pvElement, void *pvExtra);
+   char *pcExtras;
+   size_t uExtraSize;
+};
 
-   while (ppvLo <= ppvHi)
-   {
-      ppvMid = ppvLo + ((ppvHi - ppvLo) / 2);
-      iCompare = (*pfCompare)(*ppvMid, pvSoughtElement);
-      if (iCompare > 0)
-         ppvHi = ppvMid - 1;
-      else if (iCompare < 0)
-         ppvLo = ppvMid + 1;
-      else
-         return ppvMid;
-   }
-   *pppvInsert = ppvLo;
-   return NULL;
+/* Apply the function of pvBatch, a struct DynArrayMapBatch, to each
+   element of its uRun'th run. */
+
+static void DynArray_runMapJob(void *pvBatch, size_t uRun)
+{
+   struct DynArrayMapBatch *psBatch = (struct DynArrayMapBatch*)pvBatch;
+   size_t uStart;
+   size_t uEnd;
+   void *pvExtra;
+
+   assert(psBatch != NULL);
+   assert(uRun < psBatch->uRuns);
+
+   uStart = DynArray_runStart(psBatch->oDynArray->uLength, uRun,
+                              psBatch->uRuns);
+   uEnd = DynArray_runStart(psBatch->oDynArray->uLength, uRun + 1,
+                            psBatch->uRuns);
+   pvExtra = psBatch->pcExtras + uRun * psBatch->uExtraSize;
+   while (uStart < uEnd)
+      (*psBatch->pfApply)((void*)psBatch->oDynArray->ppvArray[uStart++],
+                          pvExtra);
 }
 
 /*--------------------------------------------------------------------*/
 
-int DynArray_bsearch(DynArray_T oDynArray,
-                     void *pvSoughtElement,
-                     size_t *puIndex,
-                     int (*pfCompare)(const void *pvElement1,
-                                      const void *pvElement2))
+void DynArray_mapParallel(DynArray_T oDynArray,
+                          void (*pfApply)(void *pvElement,
+                                          void *pvExtra),
+                          void *pvExtras,
+                          size_t uExtraSize,
+                          size_t uThreads)
 {
-   const void **ppvElement;
-   const void **ppvInsert = NULL;
+   struct DynArrayMapBatch sBatch;
+   size_t u;
 
    assert(oDynArray != NULL);
-   assert(puIndex != NULL);
-   assert(pfCompare != NULL);
+   assert(pfApply != NULL);
+   assert(uThreads > 0);
    assert(DynArray_isValid(oDynArray));
 
-   if (oDynArray->uLength == 0) {
-      *puIndex = 0;
-      return 0;
-   }
-
-   ppvElement = DynArray_bsearchHelp(
-      pvSoughtElement,
-      &oDynArray->ppvArray[0],
-      &oDynArray->ppvArray[oDynArray->uLength-1],
-      pfCompare,
-      &ppvInsert);
+   sBatch.oDynArray = oDynArray;
+   sBatch.uRuns = uThreads;
+   sBatch.pfApply = pfApply;
+   sBatch.pcExtras = (char*)pvExtras;
+   sBatch.uExtraSize = uExtraSize;
 
-   if (ppvElement == NULL) {
-      *puIndex = (size_t)(ppvInsert - &oDynArray->ppvArray[0]);
-      return 0;
+   /* Short runs are applied one after another in order. */
+   if (oDynArray->uLength / uThreads < PARALLEL_MAP_LENGTH)
+   {
+      for (u = 0; u < uThreads; u++)
+         DynArray_runMapJob(&sBatch, u);
+      return;
    }
 
-   *puIndex = (size_t)(ppvElement - &oDynArray->ppvArray[0]);
-   return 1;
+   DynArray_runBatch(DynArray_runMapJob, &sBatch, uThreads);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* DynArray_sort is a pattern-defeating quicksort, after Orson
+   Peters's pdqsort: a quicksort that sorts small partitions by
+   insertion sort, detects partitions that are already (nearly)
+   sorted, breaks up patterns that produce bad pivots, and falls back
+   to heapsort if bad pivots persist, so that it takes O(n log n) time
+   in the worst case and O(n) time on sorted input. */
+
+/* Partitions shorter than this are sorted by insertion sort. */
+
+static const size_t INSERTION_SORT_LENGTH = 24;
+
+/* Partitions longer than this use the median of three medians of
+   three as the pivot, rather than the median of three. */
+
+static const size_t NINTHER_LENGTH = 128;
+
+/* The number of element moves after which DynArray_partialSort gives
+   up. */
+
+static const size_t PARTIAL_SORT_LIMIT = 8;
+
+/*--------------------------------------------------------------------*/
+
+/* Swap the elements at ppvFirst and ppvSecond. */
+
+static void DynArray_swap(const void **ppvFirst, const void **ppvSecond)
+{
+   const void *pvTemp;
+
+   assert(ppvFirst != NULL);
+   assert(ppvSecond != NULL);
+
+   pvTemp = *ppvFirst;
+   *ppvFirst = *ppvSecond;
+   *ppvSecond = pvTemp;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Reorder the elements at ppvA, ppvB, and ppvC so that they are in
+   ascending order, as determined by *pfCompare. */
+
+static void DynArray_sort3(
+   const void **ppvA,
+   const void **ppvB,
+   const void **ppvC,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   assert(pfCompare != NULL);
+
+   if ((*pfCompare)(*ppvB, *ppvA) < 0)
+      DynArray_swap(ppvA, ppvB);
+   if ((*pfCompare)(*ppvC, *ppvB) < 0)
+   {
+      DynArray_swap(ppvB, ppvC);
+      if ((*pfCompare)(*ppvB, *ppvA) < 0)
+         DynArray_swap(ppvA, ppvB);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Sort the uLength elements at ppvArray in ascending order, as
+   determined by *pfCompare, by insertion sort. */
+
+static void DynArray_insertionSort(
+   const void **ppvArray,
+   size_t uLength,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   const void *pvElement;
+   size_t u;
+   size_t uHole;
+
+   assert(ppvArray != NULL);
+   assert(pfCompare != NULL);
+
+   for (u = 1; u < uLength; u++)
+   {
+      pvElement = ppvArray[u];
+      for (uHole = u;
+           uHole > 0 && (*pfCompare)(pvElement, ppvArray[uHole-1]) < 0;
+           uHole--)
+         ppvArray[uHole] = ppvArray[uHole-1];
+      ppvArray[uHole] = pvElement;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Attempt to sort the uLength elements at ppvArray by insertion sort,
+   giving up once PARTIAL_SORT_LIMIT elements have been moved.  Return
+   1 (TRUE) if the elements are now sorted, or 0 (FALSE) if the
+   attempt was abandoned. */
+
+static int DynArray_partialSort(
+   const void **ppvArray,
+   size_t uLength,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   const void *pvElement;
+   size_t u;
+   size_t uHole;
+   size_t uMoves = 0;
+
+   assert(ppvArray != NULL);
+   assert(pfCompare != NULL);
+
+   for (u = 1; u < uLength; u++)
+   {
+      if (uMoves > PARTIAL_SORT_LIMIT)
+         return 0;
+
+      pvElement = ppvArray[u];
+      for (uHole = u;
+           uHole > 0 && (*pfCompare)(pvElement, ppvArray[uHole-1]) < 0;
+           uHole--)
+         ppvArray[uHole] = ppvArray[uHole-1];
+      ppvArray[uHole] = pvElement;
+      uMoves += u - uHole;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Restore the heap property of the uLength elements at ppvArray, a
+   max-heap as determined by *pfCompare except perhaps at index
+   uRoot, by moving that element down. */
+
+static void DynArray_siftDown(
+   const void **ppvArray,
+   size_t uRoot,
+   size_t uLength,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   const void *pvElement;
+   size_t uChild;
+
+   assert(ppvArray != NULL);
+   assert(pfCompare != NULL);
+
+   pvElement = ppvArray[uRoot];
+   while (uRoot < uLength / 2)
+   {
+      uChild = 2 * uRoot + 1;
+      if (uChild + 1 < uLength &&
+          (*pfCompare)(ppvArray[uChild], ppvArray[uChild+1]) < 0)
+         uChild++;
+      if ((*pfCompare)(pvElement, ppvArray[uChild]) >= 0)
+         break;
+      ppvArray[uRoot] = ppvArray[uChild];
+      uRoot = uChild;
+   }
+   ppvArray[uRoot] = pvElement;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Sort the uLength elements at ppvArray in ascending order, as
+   determined by *pfCompare, by heapsort. */
+
+static void DynArray_heapSort(
+   const void **ppvArray,
+   size_t uLength,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   size_t u;
+
+   assert(ppvArray != NULL);
+   assert(pfCompare != NULL);
+
+   for (u = uLength / 2; u > 0; u--)
+      DynArray_siftDown(ppvArray, u - 1, uLength, pfCompare);
+   for (u = uLength; u > 1; u--)
+   {
+      DynArray_swap(&ppvArray[0], &ppvArray[u-1]);
+      DynArray_siftDown(ppvArray, 0, u - 1, pfCompare);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Partition the uLength elements at ppvArray about the pivot
+   ppvArray[0], placing elements less than the pivot before it and
+   the rest after it.  ppvArray[uLength-1] must not be less than the
+   pivot.  Set *piPartitioned to 1 (TRUE) if no elements needed to be
+   moved, and to 0 (FALSE) otherwise.  Return the pivot's new index. */
+
+static size_t DynArray_partitionRight(
+   const void **ppvArray,
+   size_t uLength,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2),
+   int *piPartitioned)
+{
+   const void *pvPivot;
+   size_t uFirst = 0;
+   size_t uLast = uLength;
+
+   assert(ppvArray != NULL);
+   assert(pfCompare != NULL);
+   assert(piPartitioned != NULL);
+
+   pvPivot = ppvArray[0];
+
+   /* Find the first element not less than the pivot... */
+   while ((*pfCompare)(ppvArray[++uFirst], pvPivot) < 0)
+      ;
+
+   /* ...and the last element less than it, which needs a bounds
+      check only if nothing before uFirst stops the search. */
+   if (uFirst == 1)
+      while (uFirst < uLast &&
+             (*pfCompare)(ppvArray[--uLast], pvPivot) >= 0)
+         ;
+   else
+      while ((*pfCompare)(ppvArray[--uLast], pvPivot) >= 0)
+         ;
+
+   *piPartitioned = (uFirst >= uLast);
+
+   while (uFirst < uLast)
+   {
+      DynArray_swap(&ppvArray[uFirst], &ppvArray[uLast]);
+      while ((*pfCompare)(ppvArray[++uFirst], pvPivot) < 0)
+         ;
+      while ((*pfCompare)(ppvArray[--uLast], pvPivot) >= 0)
+         ;
+   }
+
+   ppvArray[0] = ppvArray[uFirst-1];
+   ppvArray[uFirst-1] = pvPivot;
+   return uFirst - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Partition the uLength elements at ppvArray about the pivot
+   ppvArray[0], placing elements equal to the pivot before it and
+   elements greater than it after it.  No element may be less than the
+   pivot.  Return the pivot's new index. */
+
+static size_t DynArray_partitionLeft(
+   const void **ppvArray,
+   size_t uLength,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   const void *pvPivot;
+   size_t uFirst = 0;
+   size_t uLast = uLength;
+
+   assert(ppvArray != NULL);
+   assert(pfCompare != NULL);
+
+   pvPivot = ppvArray[0];
+
+   /* The pivot itself stops this search. */
+   while ((*pfCompare)(pvPivot, ppvArray[--uLast]) < 0)
+      ;
+
+   if (uLast + 1 == uLength)
+      while (uFirst < uLast &&
+             (*pfCompare)(pvPivot, ppvArray[++uFirst]) >= 0)
+         ;
+   else
+      while ((*pfCompare)(pvPivot, ppvArray[++uFirst]) >= 0)
+         ;
+
+   while (uFirst < uLast)
+   {
+      DynArray_swap(&ppvArray[uFirst], &ppvArray[uLast]);
+      while ((*pfCompare)(pvPivot, ppvArray[--uLast]) < 0)
+         ;
+      while ((*pfCompare)(pvPivot, ppvArray[++uFirst]) >= 0)
+         ;
+   }
+
+   ppvArray[0] = ppvArray[uLast];
+   ppvArray[uLast] = pvPivot;
+   return uLast;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Swap a few elements of the uLength elements at ppvArray, which
+   form one side of a badly unbalanced partition, into new
+   positions, to break up whatever pattern produced the bad pivot. */
+
+static void DynArray_shuffle(const void **ppvArray, size_t uLength)
+{
+   size_t uQuarter;
+
+   assert(ppvArray != NULL);
+
+   if (uLength < INSERTION_SORT_LENGTH)
+      return;
+
+   uQuarter = uLength / 4;
+   DynArray_swap(&ppvArray[0], &ppvArray[uQuarter]);
+   DynArray_swap(&ppvArray[uLength-1], &ppvArray[uLength-uQuarter]);
+   if (uLength > NINTHER_LENGTH)
+   {
+      DynArray_swap(&ppvArray[1], &ppvArray[uQuarter+1]);
+      DynArray_swap(&ppvArray[2], &ppvArray[uQuarter+2]);
+      DynArray_swap(&ppvArray[uLength-2],
+                    &ppvArray[uLength-uQuarter-1]);
+      DynArray_swap(&ppvArray[uLength-3],
+                    &ppvArray[uLength-uQuarter-2]);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Sort the uLength elements at ppvArray in ascending order, as
+   determined by *pfCompare.  uBadAllowed is the number of badly
+   unbalanced partitions to tolerate before switching to heapsort.
+   iLeftmost is 1 (TRUE) if ppvArray is the start of the whole array,
+   and 0 (FALSE) if ppvArray[-1] is a pivot from an earlier partition,
+   which is then not greater than any element here.  Only the smaller
+   side of each partition is sorted recursively, so the recursion is
+   at most logarithmically deep. */
+
+static void DynArray_pdqsort(
+   const void **ppvArray,
+   size_t uLength,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2),
+   size_t uBadAllowed,
+   int iLeftmost)
+{
+   size_t uHalf;
+   size_t uPivot;
+   size_t uLeft;
+   size_t uRight;
+   int iPartitioned;
+
+   assert(ppvArray != NULL);
+   assert(pfCompare != NULL);
+
+   for (;;)
+   {
+      if (uLength < INSERTION_SORT_LENGTH)
+      {
+         DynArray_insertionSort(ppvArray, uLength, pfCompare);
+         return;
+      }
+
+      /* Move the median of three (or of three medians) to the front,
+         leaving an element not less than it at the end. */
+      uHalf = uLength / 2;
+      if (uLength > NINTHER_LENGTH)
+      {
+         DynArray_sort3(&ppvArray[0], &ppvArray[uHalf],
+                        &ppvArray[uLength-1], pfCompare);
+         DynArray_sort3(&ppvArray[1], &ppvArray[uHalf-1],
+                        &ppvArray[uLength-2], pfCompare);
+         DynArray_sort3(&ppvArray[2], &ppvArray[uHalf+1],
+                        &ppvArray[uLength-3], pfCompare);
+         DynArray_sort3(&ppvArray[uHalf-1], &ppvArray[uHalf],
+                        &ppvArray[uHalf+1], pfCompare);
+         DynArray_swap(&ppvArray[0], &ppvArray[uHalf]);
+      }
+      else
+         DynArray_sort3(&ppvArray[uHalf], &ppvArray[0],
+                        &ppvArray[uLength-1], pfCompare);
+
+      /* If the pivot equals the preceding pivot, then every element
+         equal to it can be set aside at once, which keeps many
+         duplicates from degrading the sort. */
+      if (! iLeftmost && (*pfCompare)(ppvArray[-1], ppvArray[0]) >= 0)
+      {
+         uPivot = DynArray_partitionLeft(ppvArray, uLength, pfCompare);
+         ppvArray += uPivot + 1;
+         uLength -= uPivot + 1;
+         continue;
+      }
+
+      uPivot = DynArray_partitionRight(ppvArray, uLength, pfCompare,
+                                       &iPartitioned);
+      uLeft = uPivot;
+      uRight = uLength - uPivot - 1;
+
+      if (uLeft < uLength / 8 || uRight < uLength / 8)
+      {
+         /* A bad pivot: give up on quicksort if there have been too
+            many, and otherwise perturb both sides. */
+         if (--uBadAllowed == 0)
+         {
+            DynArray_heapSort(ppvArray, uLength, pfCompare);
+            return;
+         }
+         DynArray_shuffle(ppvArray, uLeft);
+         DynArray_shuffle(ppvArray + uPivot + 1, uRight);
+      }
+      else if (iPartitioned &&
+               DynArray_partialSort(ppvArray, uLeft, pfCompare) &&
+               DynArray_partialSort(ppvArray + uPivot + 1, uRight,
+                                    pfCompare))
+         /* The input was already (nearly) sorted. */
+         return;
+
+      if (uLeft < uRight)
+      {
+         DynArray_pdqsort(ppvArray, uLeft, pfCompare, uBadAllowed,
+                          iLeftmost);
+         ppvArray += uPivot + 1;
+         uLength = uRight;
+         iLeftmost = 0;
+      }
+      else
+      {
+         DynArray_pdqsort(ppvArray + uPivot + 1, uRight, pfCompare,
+                          uBadAllowed, 0);
+         uLength = uLeft;
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Sort the uLength elements at ppvArray in ascending order, as
+   determined by *pfCompare. */
+
+static void DynArray_sortArray(
+   const void **ppvArray,
+   size_t uLength,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   size_t uBadAllowed = 0;
+   size_t u;
+
+   assert(ppvArray != NULL);
+   assert(pfCompare != NULL);
+
+   if (uLength < 2)
+      return;
+
+   /* Sorted input needs no work, and reverse-sorted input only needs
+      reversing. */
+   for (u = 1; u < uLength; u++)
+      if ((*pfCompare)(ppvArray[u], ppvArray[u-1]) < 0)
+         break;
+   if (u == uLength)
+      return;
+   for (u = 1; u < uLength; u++)
+      if ((*pfCompare)(ppvArray[u], ppvArray[u-1]) > 0)
+         break;
+   if (u == uLength)
+   {
+      for (u = 0; u < uLength / 2; u++)
+         DynArray_swap(&ppvArray[u], &ppvArray[uLength-1-u]);
+      return;
+   }
+
+   /* Allow about log2(uLength) bad pivots. */
+   for (u = uLength; u > 1; u /= 2)
+      uBadAllowed++;
+
+   DynArray_pdqsort(ppvArray, uLength, pfCompare, uBadAllowed, 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_sort(DynArray_T oDynArray,
+                   int (*pfCompare)(const void *pvElement1,
+                                    const void *pvElement2))
+{
+   assert(oDynArray != NULL);
+   assert(pfCompare != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   DynArray_sortArray(oDynArray->ppvArray, oDynArray->uLength,
+                      pfCompare);
+
+   assert(DynArray_isValid(oDynArray));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The fewest elements that DynArray_sortParallel gives each run;
+   shorter arrays are sorted in fewer runs, or serially. */
+
+static const size_t PARALLEL_SORT_LENGTH = 32768;
+
+/* One job of a batch of DynArray_sortParallel: either
+   sorting a run in place, or producing part of the stable merge of
+   two adjacent sorted runs. */
+
+struct DynArraySortJob
+{
+   /* 1 (TRUE) for a merge, 0 (FALSE) for a sort. */
+   int iMerge;
+
+   /* The run to sort, or the first of the two runs to merge, which is
+      followed immediately by the second. */
+   const void **ppvSource;
+
+   /* The lengths of the two runs.  A sort uses only the first. */
+   size_t uLength1;
+   size_t uLength2;
+
+   /* Where the merged runs go, and the range [uBegin, uEnd) of merged
+      positions that this job fills. */
+   const void **ppvDest;
+   size_t uBegin;
+   size_t uEnd;
+
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2);
+};
+
+/* Return how many of the first uOut elements of the stable merge of
+   the uLength1 elements at ppvFirst and the uLength2 elements at
+   ppvSecond come from ppvFirst, as determined by *pfCompare. */
+
+static size_t DynArray_mergeSplit(
+   const void **ppvFirst,
+   size_t uLength1,
+   const void **ppvSecond,
+   size_t uLength2,
+   size_t uOut,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   size_t uLo;
+   size_t uHi;
+   size_t uMid;
+
+   assert(uOut <= uLength1 + uLength2);
+
+   uLo = (uOut > uLength2) ? uOut - uLength2 : 0;
+   uHi = (uOut < uLength1) ? uOut : uLength1;
+
+   /* ppvFirst[uMid] is among the first uOut elements exactly when it
+      does not come after ppvSecond[uOut-uMid-1]; ties go to the first
+      run. */
+   while (uLo < uHi)
+   {
+      uMid = uLo + (uHi - uLo) / 2;
+      if ((*pfCompare)(ppvSecond[uOut - uMid - 1], ppvFirst[uMid]) >= 0)
+         uLo = uMid + 1;
+      else
+         uHi = uMid;
+   }
+   return uLo;
+}
+
+/* Do the uJob'th job of pvBatch, an array of struct DynArraySortJob. */
+
+static void DynArray_runSortJob(void *pvBatch, size_t uJob)
+{
+   struct DynArraySortJob *psJob =
+      (struct DynArraySortJob*)pvBatch + uJob;
+   const void **ppvFirst;
+   const void **ppvSecond;
+   const void **ppvOut;
+   size_t u1;
+   size_t u2;
+   size_t uEnd1;
+   size_t uEnd2;
+
+   assert(psJob != NULL);
+
+   if (! psJob->iMerge)
+   {
+      DynArray_sortArray(psJob->ppvSource, psJob->uLength1,
+                         psJob->pfCompare);
+      return;
+   }
+
+   ppvFirst = psJob->ppvSource;
+   ppvSecond = psJob->ppvSource + psJob->uLength1;
+   u1 = DynArray_mergeSplit(ppvFirst, psJob->uLength1,
+                            ppvSecond, psJob->uLength2,
+                            psJob->uBegin, psJob->pfCompare);
+   uEnd1 = DynArray_mergeSplit(ppvFirst, psJob->uLength1,
+                               ppvSecond, psJob->uLength2,
+                               psJob->uEnd, psJob->pfCompare);
+   u2 = psJob->uBegin - u1;
+   uEnd2 = psJob->uEnd - uEnd1;
+
+   ppvOut = psJob->ppvDest + psJob->uBegin;
+   while (u1 < uEnd1 && u2 < uEnd2)
+   {
+      if ((*psJob->pfCompare)(ppvSecond[u2], ppvFirst[u1]) < 0)
+         *ppvOut++ = ppvSecond[u2++];
+      else
+         *ppvOut++ = ppvFirst[u1++];
+   }
+   memcpy(ppvOut, &ppvFirst[u1], sizeof(void*) * (uEnd1 - u1));
+   ppvOut += uEnd1 - u1;
+   memcpy(ppvOut, &ppvSecond[u2], sizeof(void*) * (uEnd2 - u2));
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_sortParallel(DynArray_T oDynArray,
+                           int (*pfCompare)(const void *pvElement1,
+                                            const void *pvElement2),
+                           size_t uThreads)
+{
+   const void **ppvSource;
+   const void **ppvDest;
+   const void **ppvTemp;
+   struct DynArraySortJob *psJobs;
+   size_t *puStarts;
+   size_t uLength;
+   size_t uRuns;
+   size_t uPairs;
+   size_t uWorkers;
+   size_t uPairLength;
+   size_t uJobs;
+   size_t u;
+   size_t w;
+
+   assert(oDynArray != NULL);
+   assert(pfCompare != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   uLength = oDynArray->uLength;
+   if (uThreads > uLength / PARALLEL_SORT_LENGTH)
+      uThreads = uLength / PARALLEL_SORT_LENGTH;
+   if (uThreads < 2)
+   {
+      DynArray_sort(oDynArray, pfCompare);
+      return;
+   }
+
+   /* The scratch space lives only until the sort returns, so it comes
+      from malloc rather than from the client's allocator, which might
+      never give it back. */
+   ppvTemp = (const void**)malloc(sizeof(void*) * uLength);
+   psJobs = (struct DynArraySortJob*)
+      malloc(sizeof(struct DynArraySortJob) * uThreads);
+   puStarts = (size_t*)malloc(sizeof(size_t) * (uThreads + 1));
+   if (ppvTemp == NULL || psJobs == NULL || puStarts == NULL)
+   {
+      free(ppvTemp);
+      free(psJobs);
+      free(puStarts);
+      DynArray_sort(oDynArray, pfCompare);
+      return;
+   }
+
+   /* Sort uThreads runs of nearly equal length at once. */
+   uRuns = uThreads;
+   for (u = 0; u <= uRuns; u++)
+      puStarts[u] = DynArray_runStart(uLength, u, uRuns);
+   for (u = 0; u < uRuns; u++)
+   {
+      psJobs[u].iMerge = 0;
+      psJobs[u].ppvSource = oDynArray->ppvArray + puStarts[u];
+      psJobs[u].uLength1 = puStarts[u+1] - puStarts[u];
+      psJobs[u].pfCompare = pfCompare;
+   }
+   DynArray_runBatch(DynArray_runSortJob, psJobs, uRuns);
+
+   /* Then merge pairs of adjacent runs until one is left, dividing
+      the output of each pair among the threads so that all of them
+      stay busy as the runs become fewer. */
+   ppvSource = oDynArray->ppvArray;
+   ppvDest = ppvTemp;
+   while (uRuns > 1)
+   {
+      uPairs = (uRuns + 1) / 2;
+      uWorkers = uThreads / uPairs;
+      uJobs = 0;
+      for (u = 0; u < uPairs; u++)
+      {
+         uPairLength = puStarts[(2*u+2 < uRuns) ? 2*u+2 : uRuns]
+            - puStarts[2*u];
+         for (w = 0; w < uWorkers; w++)
+         {
+            psJobs[uJobs].iMerge = 1;
+            psJobs[uJobs].ppvSource = ppvSource + puStarts[2*u];
+            psJobs[uJobs].uLength1 = puStarts[2*u+1] - puStarts[2*u];
+            psJobs[uJobs].uLength2 =
+               uPairLength - psJobs[uJobs].uLength1;
+            psJobs[uJobs].ppvDest = ppvDest + puStarts[2*u];
+            psJobs[uJobs].uBegin = uPairLength / uWorkers * w;
+            psJobs[uJobs].uEnd = (w + 1 == uWorkers) ? uPairLength
+               : uPairLength / uWorkers * (w + 1);
+            psJobs[uJobs].pfCompare = pfCompare;
+            uJobs++;
+         }
+      }
+      DynArray_runBatch(DynArray_runSortJob, psJobs, uJobs);
+
+      for (u = 0; u < uPairs; u++)
+         puStarts[u] = puStarts[2*u];
+      puStarts[uPairs] = uLength;
+      uRuns = uPairs;
+
+      ppvTemp = ppvSource;
+      ppvSource = ppvDest;
+      ppvDest = ppvTemp;
+   }
+
+   if (ppvSource != oDynArray->ppvArray)
+   {
+      memcpy(oDynArray->ppvArray, ppvSource, sizeof(void*) * uLength);
+      ppvDest = ppvSource;
+   }
+   free(ppvDest);
+   free(psJobs);
+   free(puStarts);
+
+   assert(DynArray_isValid(oDynArray));
+}
+
+/*--------------------------------------------------------------------*/
+
+int DynArray_search(DynArray_T oDynArray,
+                    void *pvSoughtElement,
+                    size_t *puIndex,
+                    int (*pfCompare)(const void *pvElement1,
+                                     const void *pvElement2))
+{
+   size_t u;
+
+   assert(oDynArray != NULL);
+   assert(puIndex != NULL);
+   assert(pfCompare != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   for (u = 0; u < oDynArray->uLength; u++)
+      if ((*pfCompare)(oDynArray->ppvArray[u], pvSoughtElement) == 0)
+      {
+         *puIndex = u;
+         return 1;
+      }
+   return 0;
+}
+
+
+
+/*--------------------------------------------------------------------*/
+
+int DynArray_bsearch(DynArray_T oDynArray,
+                     void *pvSoughtElement,
+                     size_t *puIndex,
+                     int (*pfCompare)(const void *pvElement1,
+                                      const void *pvElement2))
+{
+   const void **ppvArray;
+   size_t uBase = 0;
+   size_t uLength;
+   size_t uHalf;
+
+   assert(oDynArray != NULL);
+   assert(puIndex != NULL);
+   assert(pfCompare != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   ppvArray = oDynArray->ppvArray;
+   uLength = oDynArray->uLength;
+   if (uLength == 0)
+   {
+      *puIndex = 0;
+      return 0;
+   }
+
+   /* Find the first element not less than pvSoughtElement.  Each step
+      halves the range [uBase, uBase+uLength) by arithmetic on the
+      comparison's result rather than by a branch, which the processor
+      could only guess. */
+   while (uLength > 1)
+   {
+      uHalf = uLength / 2;
+      uBase += (size_t)
+         ((*pfCompare)(ppvArray[uBase + uHalf - 1],
+                       pvSoughtElement) < 0) * uHalf;
+      uLength -= uHalf;
+   }
+   uBase +=
+      (size_t)((*pfCompare)(ppvArray[uBase], pvSoughtElement) < 0);
+
+   *puIndex = uBase;
+   return uBase < oDynArray->uLength &&
+      (*pfCompare)(ppvArray[uBase], pvSoughtElement) == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A DynArrayIndex is a copy of a sorted DynArray's elements in
+   Eytzinger (breadth-first binary tree) order: the children of the
+   element at position k are at positions 2k and 2k+1, counting from
+   1.  The elements a search visits are therefore nearby in memory,
+   and the first few levels of the tree are shared by every search. */
+
+struct DynArrayIndex
+{
+   /* The number of elements. */
+   size_t uLength;
+
+   /* The elements in Eytzinger order, from position 1. */
+   const void **ppvTree;
+
+   /* The index in the original DynArray of each element of
+      ppvTree. */
+   size_t *puRanks;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Fill the subtree of oIndex rooted at position uNode with the
+   elements of ppvArray from *puNext onward, in order, and advance
+   *puNext past them. */
+
+static void DynArray_fillIndex(DynArrayIndex_T oIndex,
+                               const void **ppvArray,
+                               size_t uNode, size_t *puNext)
+{
+   assert(oIndex != NULL);
+   assert(ppvArray != NULL);
+   assert(puNext != NULL);
+
+   /* The tree is at most logarithmically deep. */
+   if (uNode > oIndex->uLength)
+      return;
+
+   DynArray_fillIndex(oIndex, ppvArray, 2 * uNode, puNext);
+   oIndex->ppvTree[uNode] = ppvArray[*puNext];
+   oIndex->puRanks[uNode] = *puNext;
+   (*puNext)++;
+   DynArray_fillIndex(oIndex, ppvArray, 2 * uNode + 1, puNext);
+}
+
+/*--------------------------------------------------------------------*/
+
+DynArrayIndex_T DynArray_index(DynArray_T oDynArray)
+{
+   DynArrayIndex_T oIndex;
+   size_t uNext = 0;
+
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   oIndex = (struct DynArrayIndex*)
+      Alloc_malloc(sizeof(struct DynArrayIndex));
+   if (oIndex == NULL)
+      return NULL;
+
+   oIndex->uLength = oDynArray->uLength;
+   oIndex->ppvTree = (const void**)
+      Alloc_malloc(sizeof(void*) * (oDynArray->uLength + 1));
+   oIndex->puRanks = (size_t*)
+      Alloc_malloc(sizeof(size_t) * (oDynArray->uLength + 1));
+   if (oIndex->ppvTree == NULL || oIndex->puRanks == NULL)
+   {
+      DynArrayIndex_free(oIndex);
+      return NULL;
+   }
+
+   DynArray_fillIndex(oIndex, oDynArray->ppvArray, 1, &uNext);
+   return oIndex;
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArrayIndex_free(DynArrayIndex_T oIndex)
+{
+   assert(oIndex != NULL);
+
+   Alloc_free(oIndex->ppvTree);
+   Alloc_free(oIndex->puRanks);
+   Alloc_free(oIndex);
+}
+
+/*--------------------------------------------------------------------*/
+
+int DynArrayIndex_bsearch(DynArrayIndex_T oIndex,
+                          void *pvSoughtElement,
+                          size_t *puIndex,
+                          int (*pfCompare)(const void *pvElement1,
+                                           const void *pvElement2))
+{
+   size_t uNode = 1;
+
+   assert(oIndex != NULL);
+   assert(puIndex != NULL);
+   assert(pfCompare != NULL);
+
+   /* Descend left or right, again without branching on the
+      comparison, until falling off the tree. */
+   while (uNode <= oIndex->uLength)
+   {
+#if defined(__GNUC__)
+      /* Fetch the node's great-great-grandchildren in the meantime. */
+      if (16 * uNode <= oIndex->uLength)
+         __builtin_prefetch(&oIndex->ppvTree[16 * uNode]);
+#endif
+      uNode = 2 * uNode + (size_t)
+         ((*pfCompare)(oIndex->ppvTree[uNode], pvSoughtElement) < 0);
+   }
+
+   /* The last node at which the search went left holds the first
+      element not less than pvSoughtElement.  Going right appended a
+      1 bit to uNode, and going left a 0 bit, so that node is found by
+      removing the trailing 1 bits and then one 0 bit. */
+   while (uNode & 1)
+      uNode >>= 1;
+   uNode >>= 1;
+
+   if (uNode == 0)
+   {
+      *puIndex = oIndex->uLength;
+      return 0;
+   }
+   *puIndex = oIndex->puRanks[uNode];
+   return (*pfCompare)(oIndex->ppvTree[uNode], pvSoughtElement) == 0;
 }
@@ -71,6 +71,51 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex);
 
 /*--------------------------------------------------------------------*/
 
+/* Add the uCount elements of ppvElements to oDynArray such that they
+   are the uIndex'th through (uIndex+uCount-1)'th elements, shifting
+   the elements after them only once.  Return 1 (TRUE) if successful,
+   or 0 (FALSE) if insufficient memory is available, in which case
+   oDynArray is unchanged. */
+
+int DynArray_insertRange(DynArray_T oDynArray, size_t uIndex,
+                         const void * const *ppvElements, size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Add the uCount elements of ppvElements to the end of oDynArray.
+   Return 1 (TRUE) if successful, or 0 (FALSE) if insufficient memory
+   is available, in which case oDynArray is unchanged. */
+
+int DynArray_appendArray(DynArray_T oDynArray,
+                         const void * const *ppvElements, size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the uCount elements of oDynArray starting with the uIndex'th
+   element, shifting the elements after them only once. */
+
+void DynArray_removeRange(DynArray_T oDynArray, size_t uIndex,
+                          size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove all elements of oDynArray after the first uLength, which
+   must not be more than oDynArray's length. */
+
+void DynArray_truncate(DynArray_T oDynArray, size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* If oDynArray uses no more than a quarter of its physical length,
+   reduce the physical length to twice its length, so that it can
+   still grow some before it must be reallocated again.  Return the
+   number of bytes released, which is 0 if oDynArray was not shrunk,
+   including if insufficient memory was available to shrink it. */
+
+size_t DynArray_shrink(DynArray_T oDynArray);
+
+/*--------------------------------------------------------------------*/
+
 /* Fill ppvArray with the elements of oDynArray.  ppvArray must point
    to an area of memory that is large enough to hold all elements of
    oDynArray. */
@@ -100,6 +145,57 @@ void DynArray_sort(DynArray_T oDynArray,
 
 /*--------------------------------------------------------------------*/
 
+/* Divide oDynArray into uThreads runs of consecutive elements, in
+   order, whose lengths differ by at most one, and apply function
+   *pfApply to each element of the t'th run, passing the t'th of the
+   uThreads objects of size uExtraSize at pvExtras as an extra
+   argument.  The runs depend only on the length of oDynArray and
+   uThreads, so each object may accumulate a result for its run, such
+   as a sum to be combined afterward.  Runs are applied at once by the
+   threads of a pool shared with DynArray_sortParallel, together with
+   the calling thread, so *pfApply must change nothing but its extra
+   argument.  An array too short to be worth the threads, or a call
+   made while the pool is busy with another, is mapped serially, run
+   by run, by the calling thread.  uThreads must be positive. */
+
+void DynArray_mapParallel(DynArray_T oDynArray,
+                          void (*pfApply)(void *pvElement,
+                                          void *pvExtra),
+                          void *pvExtras,
+                          size_t uExtraSize,
+                          size_t uThreads);
+
+/*--------------------------------------------------------------------*/
+
+/* Sort oDynArray in ascending order, as DynArray_sort does, in up to
+   uThreads runs.  The runs are sorted at once and then merged, also
+   at once, by the pool that DynArray_mapParallel uses.  Each run is
+   sizable, so short arrays use fewer runs, and an array too short for
+   two runs, or a uThreads of 0 or 1, is sorted serially by
+   DynArray_sort.  So is an array for which there is not enough memory
+   to sort in parallel; that memory comes from malloc, not from the
+   allocator of alloc.h, and is freed before returning.  The order is
+   the same as DynArray_sort's, except that elements that *pfCompare
+   finds equal may be arranged differently, since neither sort
+   guarantees the order of such elements. */
+
+void DynArray_sortParallel(DynArray_T oDynArray,
+                           int (*pfCompare)(const void *pvElement1,
+                                            const void *pvElement2),
+                           size_t uThreads);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of threads, counting the calling thread, that
+   DynArray_mapParallel and DynArray_sortParallel can run at once: the
+   number of processors online, as far as threads for them could be
+   created when the pool was started.  The result is at least 1, so it
+   is a sensible uThreads for either function. */
+
+size_t DynArray_getParallelism(void);
+
+/*--------------------------------------------------------------------*/
+
 /* Linear search oDynArray for *pvSoughtElement using *pfCompare to
    determine equality.  If the element is found, then assign its
    index to *puIndex and return 1.  If the element is not found, then
@@ -129,4 +225,39 @@ int DynArray_bsearch(DynArray_T oDynArray,
                      int (*pfCompare)(const void *pvElement1,
                                       const void *pvElement2));
 
+/*--------------------------------------------------------------------*/
+
+/* A DynArrayIndex_T object is a read-only copy of a sorted DynArray_T
+   object, laid out so that binary searches of large arrays make
+   better use of the cache.  It does not change when the DynArray_T
+   object does. */
+
+typedef struct DynArrayIndex *DynArrayIndex_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new DynArrayIndex_T object holding the elements of
+   oDynArray, which must be sorted, or NULL if insufficient memory is
+   available. */
+
+DynArrayIndex_T DynArray_index(DynArray_T oDynArray);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oIndex. */
+
+void DynArrayIndex_free(DynArrayIndex_T oIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Binary search oIndex for *pvSoughtElement as DynArray_bsearch
+   would have searched the DynArray_T object from which oIndex was
+   made, with the same return value and assignment to *puIndex. */
+
+int DynArrayIndex_bsearch(DynArrayIndex_T oIndex,
+                          void *pvSoughtElement,
+                          size_t *puIndex,
+                          int (*pfCompare)(const void *pvElement1,
+                                           const void *pvElement2));
+
 #endif
@@ -0,0 +1,282 @@
+/*--------------------------------------------------------------------*/
+/* dynarray_client.c                                                  */
+/* Author: Kok Wei Pua and Cherie Jiraphanphong                       */
+/*--------------------------------------------------------------------*/
+
+#include "dynarray.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The most elements in any array tested. */
+
+enum {MAX_VALUES = 300000};
+
+/* The integers that the arrays' elements point to. */
+
+static int aiValues[MAX_VALUES];
+
+/* Whether each of aiValues has been seen, for checking that a sort
+   permuted its array. */
+
+static char acSeen[MAX_VALUES];
+
+/* The orders in which an array to be sorted may start out. */
+
+enum Order {ORDER_SORTED, ORDER_REVERSE, ORDER_EQUAL, ORDER_RANDOM,
+            ORDER_COUNT};
+
+/*--------------------------------------------------------------------*/
+
+/* Return <0, 0, or >0 depending upon whether the integer that
+   pvElement1 points to is less than, equal to, or greater than the
+   one that pvElement2 points to. */
+
+static int compareInts(const void *pvElement1, const void *pvElement2)
+{
+   int i1 = *(const int*)pvElement1;
+   int i2 = *(const int*)pvElement2;
+
+   if (i1 < i2)
+      return -1;
+   return i1 > i2;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the first element of oDynArray, which must be
+   sorted, that is not less than *piKey, found by a linear scan. */
+
+static size_t lowerBound(DynArray_T oDynArray, int *piKey)
+{
+   size_t u;
+
+   for (u = 0; u < DynArray_getLength(oDynArray); u++)
+      if (compareInts(DynArray_get(oDynArray, u), piKey) >= 0)
+         break;
+   return u;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check DynArray_bsearch and DynArrayIndex_bsearch against a linear
+   lower bound on a sorted array of uLength elements, each value of
+   which appears twice, for every key between the values and one
+   beyond each end. */
+
+static void testBsearch(size_t uLength)
+{
+   DynArray_T oDynArray;
+   DynArrayIndex_T oIndex;
+   size_t u;
+   size_t uIndex;
+   size_t uExpected;
+   int iKey;
+   int iFound;
+
+   assert(uLength <= MAX_VALUES);
+
+   oDynArray = DynArray_new(0);
+   assert(oDynArray != NULL);
+   for (u = 0; u < uLength; u++)
+   {
+      aiValues[u] = (int)(u / 2) * 2;
+      assert(DynArray_add(oDynArray, &aiValues[u]));
+   }
+   oIndex = DynArray_index(oDynArray);
+   assert(oIndex != NULL);
+
+   for (iKey = -1; iKey <= (int)uLength + 1; iKey++)
+   {
+      uExpected = lowerBound(oDynArray, &iKey);
+
+      uIndex = MAX_VALUES;
+      iFound = DynArray_bsearch(oDynArray, &iKey, &uIndex,
+                                compareInts);
+      assert(uIndex == uExpected);
+      assert(iFound == (uExpected < uLength &&
+                        aiValues[uExpected] == iKey));
+
+      uIndex = MAX_VALUES;
+      iFound = DynArrayIndex_bsearch(oIndex, &iKey, &uIndex,
+                                     compareInts);
+      assert(uIndex == uExpected);
+      assert(iFound == (uExpected < uLength &&
+                        aiValues[uExpected] == iKey));
+   }
+
+   DynArrayIndex_free(oIndex);
+   DynArray_free(oDynArray);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that DynArray_sortParallel with uThreads threads sorts an
+   array of uLength elements that starts out in order eOrder: the
+   result must be in order and must hold each element exactly
+   once. */
+
+static void testSortParallel(size_t uLength, enum Order eOrder,
+                             size_t uThreads)
+{
+   DynArray_T oDynArray;
+   size_t u;
+   int *piValue;
+
+   assert(uLength <= MAX_VALUES);
+
+   oDynArray = DynArray_new(0);
+   assert(oDynArray != NULL);
+   for (u = 0; u < uLength; u++)
+   {
+      switch (eOrder)
+      {
+         case ORDER_SORTED:  aiValues[u] = (int)u;             break;
+         case ORDER_REVERSE: aiValues[u] = (int)(uLength - u); break;
+         case ORDER_EQUAL:   aiValues[u] = 7;                  break;
+         default:            aiValues[u] = rand() % 1000;      break;
+      }
+      assert(DynArray_add(oDynArray, &aiValues[u]));
+   }
+
+   DynArray_sortParallel(oDynArray, compareInts, uThreads);
+
+   assert(DynArray_getLength(oDynArray) == uLength);
+   for (u = 0; u < uLength; u++)
+      acSeen[u] = 0;
+   for (u = 0; u < uLength; u++)
+   {
+      piValue = (int*)DynArray_get(oDynArray, u);
+      assert(piValue >= aiValues && piValue < aiValues + uLength);
+      assert(! acSeen[piValue - aiValues]);
+      acSeen[piValue - aiValues] = 1;
+      if (u > 0)
+         assert(compareInts(DynArray_get(oDynArray, u - 1),
+                            piValue) <= 0);
+   }
+
+   DynArray_free(oDynArray);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that each of the first uLength elements of oDynArray is
+   &aiValues[uFirst+u], where u is the element's index. */
+
+static void checkRun(DynArray_T oDynArray, size_t uFirst,
+                     size_t uLength)
+{
+   size_t u;
+
+   assert(DynArray_getLength(oDynArray) >= uLength);
+   for (u = 0; u < uLength; u++)
+      assert(DynArray_get(oDynArray, u) == &aiValues[uFirst + u]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that arrays keep their elements as their storage grows past
+   the 1 MiB beyond which it is a memory mapping of its own, is
+   remapped, and shrinks back below that into ordinary memory. */
+
+static void testLargeArray(void)
+{
+   enum {MAPPED_LENGTH = 1048576 / sizeof(void*)};
+   enum {INSERTED = 1000};
+   static const void *apvInserted[INSERTED];
+   DynArray_T oDynArray;
+   size_t u;
+
+   assert(MAX_VALUES > 2 * MAPPED_LENGTH);
+   for (u = 0; u < MAX_VALUES; u++)
+      aiValues[u] = (int)u;
+
+   /* A new array big enough to be mapped starts out all NULL. */
+   oDynArray = DynArray_new(MAPPED_LENGTH + 1);
+   assert(oDynArray != NULL);
+   assert(DynArray_getLength(oDynArray) == MAPPED_LENGTH + 1);
+   for (u = 0; u <= MAPPED_LENGTH; u++)
+      assert(DynArray_get(oDynArray, u) == NULL);
+   assert(DynArray_set(oDynArray, MAPPED_LENGTH, &aiValues[0]) == NULL);
+   assert(DynArray_get(oDynArray, MAPPED_LENGTH) == &aiValues[0]);
+   DynArray_free(oDynArray);
+
+   /* Growing one element at a time moves the elements into a mapping
+      once, and then remaps it. */
+   oDynArray = DynArray_new(0);
+   assert(oDynArray != NULL);
+   for (u = 0; u < MAX_VALUES; u++)
+      assert(DynArray_add(oDynArray, &aiValues[u]));
+   checkRun(oDynArray, 0, MAX_VALUES);
+
+   /* Ranges move within the mapping. */
+   for (u = 0; u < INSERTED; u++)
+      apvInserted[u] = DynArray_get(oDynArray, MAPPED_LENGTH + u);
+   DynArray_removeRange(oDynArray, MAPPED_LENGTH, INSERTED);
+   assert(DynArray_get(oDynArray, MAPPED_LENGTH) ==
+          &aiValues[MAPPED_LENGTH + INSERTED]);
+   assert(DynArray_insertRange(oDynArray, MAPPED_LENGTH, apvInserted,
+                               INSERTED));
+   checkRun(oDynArray, 0, MAX_VALUES);
+   DynArray_removeRange(oDynArray, 0, INSERTED);
+   checkRun(oDynArray, INSERTED, MAX_VALUES - INSERTED);
+
+   /* A mostly empty mapping shrinks in place... */
+   DynArray_truncate(oDynArray, MAPPED_LENGTH);
+   assert(DynArray_shrink(oDynArray) > 0);
+   checkRun(oDynArray, INSERTED, MAPPED_LENGTH);
+
+   /* ...and a small enough one moves back into ordinary memory. */
+   DynArray_truncate(oDynArray, INSERTED);
+   assert(DynArray_shrink(oDynArray) > 0);
+   checkRun(oDynArray, INSERTED, INSERTED);
+
+   /* Growing again remaps it. */
+   for (u = 2 * INSERTED; u < MAX_VALUES; u++)
+      assert(DynArray_add(oDynArray, &aiValues[u]));
+   checkRun(oDynArray, INSERTED, MAX_VALUES - INSERTED);
+
+   DynArray_free(oDynArray);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the DynArray implementation's searches, sorts, and storage
+   for large arrays.  Return 0. */
+
+int main(void)
+{
+   size_t u;
+   size_t uThreads;
+   int iOrder;
+   static const size_t auSearchLengths[] =
+      {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 100, 1023, 1024, 1025,
+       4000};
+   static const size_t auSortLengths[] =
+      {0, 1, 1000, 65535, 65536, 65537, 98305, 262143, 262144,
+       262151};
+   static const size_t auSortThreads[] = {1, 2, 3, 8};
+
+   for (u = 0; u < sizeof(auSearchLengths) / sizeof(size_t); u++)
+      testBsearch(auSearchLengths[u]);
+   fprintf(stderr, "bsearch: OK\n");
+
+   /* Lengths around multiples of the 32768 elements that each thread
+      is given, so that some arrays get fewer threads than asked for,
+      and some an odd number of runs to merge. */
+   for (u = 0; u < sizeof(auSortLengths) / sizeof(size_t); u++)
+      for (iOrder = 0; iOrder < ORDER_COUNT; iOrder++)
+         for (uThreads = 0;
+              uThreads < sizeof(auSortThreads) / sizeof(size_t);
+              uThreads++)
+            testSortParallel(auSortLengths[u], (enum Order)iOrder,
+                             auSortThreads[uThreads]);
+   fprintf(stderr, "sortParallel: OK\n");
+
+   testLargeArray();
+   fprintf(stderr, "large arrays: OK\n");
+
+   return 0;
+}
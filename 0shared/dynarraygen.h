@@ -0,0 +1,1255 @@
+/*--------------------------------------------------------------------*/
+/* dynarraygen.h                                                      */
+/* Author: Kok Wei Pua and Cherie Jiraphanphong                       */
+/*--------------------------------------------------------------------*/
+
+#ifndef DYNARRAYGEN_INCLUDED
+#define DYNARRAYGEN_INCLUDED
+
+#include <assert.h>
+#include <string.h>
+
+#include "alloc.h"
+
+/* Macros that generate typed versions of the DynArray_T interface in
+   dynarray.h. A generated array stores elements of its own type
+   rather than void pointers, and each search function is
+   generated for one particular comparison function, which the
+   compiler can then call directly or inline instead of calling
+   through a function pointer. All generated functions are static, so
+   each source file that uses an array type generates its own. */
+
+/*--------------------------------------------------------------------*/
+
+/* Marks generated functions that a given source file may not use. */
+
+#if defined(__GNUC__)
+#define DYNARRAY_UNUSED __attribute__((unused))
+#else
+#define DYNARRAY_UNUSED
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Generate the functions that are the same for arrays generated by
+   DYNARRAY_DEFINE and DYNARRAY_DEFINE_SMALL: getLength, get, set, add,
+   addAt, removeAt, insertRange, appendArray, removeRange, and
+   truncate. Name##_reserve must already be defined. */
+
+#define DYNARRAY_DEFINE_ACCESS(Name, Type)                              \
+                                                                        \
+/* Double the physical length of oArray.  Return 1 (TRUE) if            \
+   successful and 0 (FALSE) if insufficient memory is available. */     \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_grow(Name##_T oArray)                 \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   return Name##_reserve(oArray, oArray->uPhysLength + 1);              \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED size_t Name##_getLength(Name##_T oArray)         \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   return oArray->uLength;                                              \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED Type Name##_get(Name##_T oArray, size_t uIndex)  \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+   assert(uIndex < oArray->uLength);                                    \
+                                                                        \
+   return oArray->paElements[uIndex];                                   \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED Type Name##_set(Name##_T oArray, size_t uIndex,  \
+                                       Type element)                    \
+{                                                                       \
+   Type oldElement;                                                     \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(uIndex < oArray->uLength);                                    \
+                                                                        \
+   oldElement = oArray->paElements[uIndex];                             \
+   oArray->paElements[uIndex] = element;                                \
+   return oldElement;                                                   \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_add(Name##_T oArray, Type element)    \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   if (oArray->uLength == oArray->uPhysLength)                          \
+      if (! Name##_grow(oArray))                                        \
+         return 0;                                                      \
+                                                                        \
+   oArray->paElements[oArray->uLength] = element;                       \
+   oArray->uLength++;                                                   \
+   return 1;                                                            \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_addAt(Name##_T oArray, size_t uIndex, \
+                                        Type element)                   \
+{                                                                       \
+   size_t u;                                                            \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(uIndex <= oArray->uLength);                                   \
+                                                                        \
+   if (oArray->uLength == oArray->uPhysLength)                          \
+      if (! Name##_grow(oArray))                                        \
+         return 0;                                                      \
+                                                                        \
+   for (u = oArray->uLength; u > uIndex; u--)                           \
+      oArray->paElements[u] = oArray->paElements[u-1];                  \
+                                                                        \
+   oArray->paElements[uIndex] = element;                                \
+   oArray->uLength++;                                                   \
+   return 1;                                                            \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED Type Name##_removeAt(Name##_T oArray,            \
+                                            size_t uIndex)              \
+{                                                                       \
+   Type oldElement;                                                     \
+   size_t u;                                                            \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(uIndex < oArray->uLength);                                    \
+                                                                        \
+   oldElement = oArray->paElements[uIndex];                             \
+   oArray->uLength--;                                                   \
+   for (u = uIndex; u < oArray->uLength; u++)                           \
+      oArray->paElements[u] = oArray->paElements[u+1];                  \
+   return oldElement;                                                   \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_insertRange(Name##_T oArray,          \
+                                              size_t uIndex,            \
+                                              const Type *paElements,   \
+                                              size_t uCount)            \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+   assert(uIndex <= oArray->uLength);                                   \
+   assert(paElements != NULL || uCount == 0);                           \
+                                                                        \
+   if (uCount == 0)                                                     \
+      return 1;                                                         \
+                                                                        \
+   if (oArray->uPhysLength - oArray->uLength < uCount)                  \
+      if (! Name##_reserve(oArray, oArray->uLength + uCount))           \
+         return 0;                                                      \
+                                                                        \
+   memmove(&oArray->paElements[uIndex + uCount],                        \
+           &oArray->paElements[uIndex],                                 \
+           sizeof(Type) * (oArray->uLength - uIndex));                  \
+   memcpy(&oArray->paElements[uIndex], paElements,                      \
+          sizeof(Type) * uCount);                                       \
+   oArray->uLength += uCount;                                           \
+   return 1;                                                            \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_appendArray(Name##_T oArray,          \
+                                              const Type *paElements,   \
+                                              size_t uCount)            \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   return Name##_insertRange(oArray, oArray->uLength, paElements,       \
+                             uCount);                                   \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_removeRange(Name##_T oArray,         \
+                                               size_t uIndex,           \
+                                               size_t uCount)           \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+   assert(uIndex <= oArray->uLength);                                   \
+   assert(uCount <= oArray->uLength - uIndex);                          \
+                                                                        \
+   memmove(&oArray->paElements[uIndex],                                 \
+           &oArray->paElements[uIndex + uCount],                        \
+           sizeof(Type) * (oArray->uLength - uIndex - uCount));         \
+   oArray->uLength -= uCount;                                           \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_truncate(Name##_T oArray,            \
+                                            size_t uLength)             \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+   assert(uLength <= oArray->uLength);                                  \
+                                                                        \
+   oArray->uLength = uLength;                                           \
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Generate the typed array type Name##_T, whose elements have type
+   Type, and the following functions, which behave as the DynArray_
+   functions of the same names do:
+
+      Name##_T Name##_new(size_t uLength);
+      void Name##_free(Name##_T oArray);
+      size_t Name##_getLength(Name##_T oArray);
+      Type Name##_get(Name##_T oArray, size_t uIndex);
+      Type Name##_set(Name##_T oArray, size_t uIndex, Type element);
+      int Name##_add(Name##_T oArray, Type element);
+      int Name##_addAt(Name##_T oArray, size_t uIndex, Type element);
+      Type Name##_removeAt(Name##_T oArray, size_t uIndex);
+      int Name##_insertRange(Name##_T oArray, size_t uIndex,
+                             const Type *paElements, size_t uCount);
+      int Name##_appendArray(Name##_T oArray, const Type *paElements,
+                             size_t uCount);
+      void Name##_removeRange(Name##_T oArray, size_t uIndex,
+                              size_t uCount);
+      void Name##_truncate(Name##_T oArray, size_t uLength);
+      size_t Name##_shrink(Name##_T oArray);
+
+   The elements of a new array of nonzero length are zero bytes. */
+
+#define DYNARRAY_DEFINE(Name, Type)                                     \
+                                                                        \
+typedef struct Name                                                     \
+{                                                                       \
+   /* The number of elements from the client's point of view. */       \
+   size_t uLength;                                                      \
+   /* The number of elements in the underlying array. */               \
+   size_t uPhysLength;                                                  \
+   /* The underlying array. */                                          \
+   Type *paElements;                                                    \
+} *Name##_T;                                                            \
+                                                                        \
+/* Grow the physical length of oArray to at least uMinLength, or to     \
+   double its current length if that is more.  Return 1 (TRUE) if       \
+   successful and 0 (FALSE) if insufficient memory is available. */     \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_reserve(Name##_T oArray,              \
+                                          size_t uMinLength)            \
+{                                                                       \
+   Type *paNew;                                                         \
+   size_t uNewLength;                                                   \
+                                                                        \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   uNewLength = 2 * oArray->uPhysLength;                                \
+   if (uNewLength < uMinLength)                                         \
+      uNewLength = uMinLength;                                          \
+                                                                        \
+   paNew = (Type *)Alloc_realloc(oArray->paElements,                    \
+                                 sizeof(Type) * uNewLength);            \
+   if (paNew == NULL)                                                   \
+      return 0;                                                         \
+                                                                        \
+   oArray->uPhysLength = uNewLength;                                    \
+   oArray->paElements = paNew;                                          \
+   return 1;                                                            \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED Name##_T Name##_new(size_t uLength)              \
+{                                                                       \
+   Name##_T oArray;                                                     \
+                                                                        \
+   oArray = (Name##_T)Alloc_malloc(sizeof(struct Name));                \
+   if (oArray == NULL)                                                  \
+      return NULL;                                                      \
+                                                                        \
+   oArray->uLength = uLength;                                           \
+   if (uLength > 2)                                                     \
+      oArray->uPhysLength = uLength;                                    \
+   else                                                                 \
+      oArray->uPhysLength = 2;                                          \
+                                                                        \
+   oArray->paElements =                                                 \
+      (Type *)Alloc_calloc(oArray->uPhysLength, sizeof(Type));          \
+   if (oArray->paElements == NULL)                                      \
+   {                                                                    \
+      Alloc_free(oArray);                                               \
+      return NULL;                                                      \
+   }                                                                    \
+                                                                        \
+   return oArray;                                                       \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_free(Name##_T oArray)                \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   Alloc_free(oArray->paElements);                                      \
+   Alloc_free(oArray);                                                  \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED size_t Name##_shrink(Name##_T oArray)            \
+{                                                                       \
+   Type *paNew;                                                         \
+   size_t uNewLength;                                                   \
+   size_t uFreed;                                                       \
+                                                                        \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   if (oArray->uLength > oArray->uPhysLength / 4)                       \
+      return 0;                                                         \
+   uNewLength = 2 * oArray->uLength;                                    \
+   if (uNewLength < 2)                                                  \
+      uNewLength = 2;                                                   \
+   if (uNewLength >= oArray->uPhysLength)                               \
+      return 0;                                                         \
+                                                                        \
+   paNew = (Type *)Alloc_realloc(oArray->paElements,                    \
+                                 sizeof(Type) * uNewLength);            \
+   if (paNew == NULL)                                                   \
+      return 0;                                                         \
+                                                                        \
+   uFreed = sizeof(Type) * (oArray->uPhysLength - uNewLength);          \
+   oArray->uPhysLength = uNewLength;                                    \
+   oArray->paElements = paNew;                                          \
+   return uFreed;                                                       \
+}                                                                       \
+                                                                        \
+DYNARRAY_DEFINE_ACCESS(Name, Type)
+
+/*--------------------------------------------------------------------*/
+
+/* Generate the typed array type Name##_T, whose elements have type
+   Type, as DYNARRAY_DEFINE does, except that the array keeps its first
+   uInline element slots within the struct Name itself and allocates
+   memory only once it grows beyond them. Rather than Name##_new and
+   Name##_free, it has
+
+      void Name##_init(Name##_T oArray);
+      void Name##_destroy(Name##_T oArray);
+
+   which make the struct Name at oArray an empty array, and free any
+   memory that it has allocated, respectively. A struct Name is meant
+   to be embedded in a larger object, and must not be moved while it
+   is in use. Name##_shrink also moves elements back inline once they
+   fit. */
+
+#define DYNARRAY_DEFINE_SMALL(Name, Type, uInline)                      \
+                                                                        \
+typedef struct Name                                                     \
+{                                                                       \
+   /* The number of elements from the client's point of view. */       \
+   size_t uLength;                                                      \
+   /* The number of elements in the underlying array. */               \
+   size_t uPhysLength;                                                  \
+   /* The underlying array: aInline, or memory on the heap. */         \
+   Type *paElements;                                                    \
+   /* The element slots used before the array outgrows them. */        \
+   Type aInline[uInline];                                               \
+} *Name##_T;                                                            \
+                                                                        \
+/* Grow the physical length of oArray as Name##_reserve does for        \
+   DYNARRAY_DEFINE, moving its elements to the heap if they are still   \
+   inline.  Return 1 (TRUE) if successful and 0 (FALSE) if              \
+   insufficient memory is available. */                                 \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_reserve(Name##_T oArray,              \
+                                          size_t uMinLength)            \
+{                                                                       \
+   Type *paNew;                                                         \
+   size_t uNewLength;                                                   \
+                                                                        \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   uNewLength = 2 * oArray->uPhysLength;                                \
+   if (uNewLength < uMinLength)                                         \
+      uNewLength = uMinLength;                                          \
+                                                                        \
+   if (oArray->paElements == oArray->aInline)                           \
+   {                                                                    \
+      paNew = (Type *)Alloc_malloc(sizeof(Type) * uNewLength);          \
+      if (paNew == NULL)                                                \
+         return 0;                                                      \
+      memcpy(paNew, oArray->aInline, sizeof(Type) * oArray->uLength);   \
+   }                                                                    \
+   else                                                                 \
+   {                                                                    \
+      paNew = (Type *)Alloc_realloc(oArray->paElements,                 \
+                                    sizeof(Type) * uNewLength);         \
+      if (paNew == NULL)                                                \
+         return 0;                                                      \
+   }                                                                    \
+                                                                        \
+   oArray->uPhysLength = uNewLength;                                    \
+   oArray->paElements = paNew;                                          \
+   return 1;                                                            \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_init(Name##_T oArray)                \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   oArray->uLength = 0;                                                 \
+   oArray->uPhysLength = uInline;                                       \
+   oArray->paElements = oArray->aInline;                                \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_destroy(Name##_T oArray)             \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   if (oArray->paElements != oArray->aInline)                           \
+      Alloc_free(oArray->paElements);                                   \
+   oArray->uLength = 0;                                                 \
+   oArray->uPhysLength = uInline;                                       \
+   oArray->paElements = oArray->aInline;                                \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED size_t Name##_shrink(Name##_T oArray)            \
+{                                                                       \
+   Type *paNew;                                                         \
+   size_t uNewLength;                                                   \
+   size_t uFreed;                                                       \
+                                                                        \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   if (oArray->paElements == oArray->aInline)                           \
+      return 0;                                                         \
+                                                                        \
+   /* Move elements that fit back inline. */                            \
+   if (oArray->uLength <= uInline)                                      \
+   {                                                                    \
+      memcpy(oArray->aInline, oArray->paElements,                       \
+             sizeof(Type) * oArray->uLength);                           \
+      Alloc_free(oArray->paElements);                                   \
+      uFreed = sizeof(Type) * oArray->uPhysLength;                      \
+      oArray->uPhysLength = uInline;                                    \
+      oArray->paElements = oArray->aInline;                             \
+      return uFreed;                                                    \
+   }                                                                    \
+                                                                        \
+   if (oArray->uLength > oArray->uPhysLength / 4)                       \
+      return 0;                                                         \
+   uNewLength = 2 * oArray->uLength;                                    \
+   if (uNewLength >= oArray->uPhysLength)                               \
+      return 0;                                                         \
+                                                                        \
+   paNew = (Type *)Alloc_realloc(oArray->paElements,                    \
+                                 sizeof(Type) * uNewLength);            \
+   if (paNew == NULL)                                                   \
+      return 0;                                                         \
+                                                                        \
+   uFreed = sizeof(Type) * (oArray->uPhysLength - uNewLength);          \
+   oArray->uPhysLength = uNewLength;                                    \
+   oArray->paElements = paNew;                                          \
+   return uFreed;                                                       \
+}                                                                       \
+                                                                        \
+DYNARRAY_DEFINE_ACCESS(Name, Type)
+
+/*--------------------------------------------------------------------*/
+
+/* Generate
+
+      int Function(Name##_T oArray, KeyType key, size_t *puIndex);
+
+   which binary searches oArray, an array generated by
+   DYNARRAY_DEFINE(Name, ...) or DYNARRAY_DEFINE_SMALL(Name, ...),
+   for key as DynArray_bsearch does.
+   Compare(element, key) must return <0, 0, or >0 if element is less
+   than, equal to, or greater than key, and oArray must be sorted
+   accordingly. */
+
+#define DYNARRAY_DEFINE_BSEARCH(Name, Function, KeyType, Compare)       \
+                                                                        \
+static int Function(Name##_T oArray, KeyType key, size_t *puIndex)      \
+{                                                                       \
+   size_t uBase = 0;                                                    \
+   size_t uLength;                                                      \
+   size_t uHalf;                                                        \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(puIndex != NULL);                                             \
+                                                                        \
+   uLength = oArray->uLength;                                           \
+   if (uLength == 0)                                                    \
+   {                                                                    \
+      *puIndex = 0;                                                     \
+      return 0;                                                         \
+   }                                                                    \
+                                                                        \
+   /* Find the first element not less than key, halving the range       \
+      [uBase, uBase+uLength) without branching on the comparison. */    \
+   while (uLength > 1)                                                  \
+   {                                                                    \
+      uHalf = uLength / 2;                                              \
+      uBase += (size_t)                                                 \
+         (Compare(oArray->paElements[uBase + uHalf - 1], key) < 0)      \
+         * uHalf;                                                       \
+      uLength -= uHalf;                                                 \
+   }                                                                    \
+   uBase += (size_t)(Compare(oArray->paElements[uBase], key) < 0);      \
+                                                                        \
+   *puIndex = uBase;                                                    \
+   return uBase < oArray->uLength &&                                    \
+      Compare(oArray->paElements[uBase], key) == 0;                     \
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The most levels of branches that a tree generated by
+   DYNARRAY_DEFINE_BTREE can have. Every branch but the root has at
+   least two children, so no array that fits in memory needs more. */
+
+#define DYNARRAY_BTREE_MAX_HEIGHT 64
+
+/* Generate the typed array type Name##_T, whose elements have type
+   Type, for arrays too long to shift on every insertion. Elements are
+   kept in order in the leaves of a B+-tree, each of which holds at
+   most uLeafSize elements. Each branch holds at most uBranchSize
+   children, together with the number of elements below each child
+   and the last of them, so that an element can be found either by
+   index or by value. Adding, removing, or finding an element thus
+   takes time logarithmic in the array's length. The leaves are
+   linked in order and the array remembers the last leaf that
+   Name##_get visited, so getting the elements in order takes
+   constant time per element. Name##_get thus writes to the array, so
+   unlike Name##_getLength, Name##_getSize, and the searches generated
+   by DYNARRAY_DEFINE_BTREE_BSEARCH, it must not be called on one array
+   by two threads at once. An empty array has no leaves, and no
+   leaf is ever empty. uLeafSize and uBranchSize must be at least 8.
+   The generated functions behave as the DynArray_ functions of the
+   same names do:
+
+      Name##_T Name##_new(void);
+      void Name##_free(Name##_T oArray);
+      size_t Name##_getLength(Name##_T oArray);
+      Type Name##_get(Name##_T oArray, size_t uIndex);
+      int Name##_add(Name##_T oArray, Type element);
+      int Name##_addAt(Name##_T oArray, size_t uIndex, Type element);
+      Type Name##_removeAt(Name##_T oArray, size_t uIndex);
+      int Name##_appendArray(Name##_T oArray, const Type *paElements,
+                             size_t uCount);
+      size_t Name##_shrink(Name##_T oArray);
+
+   Name##_shrink rebuilds a tree with more than twice as many leaves
+   as its elements need from full leaves, if it can allocate them.
+   Name##_appendArray fills leaves completely; if memory runs out
+   partway, it returns 0 (FALSE) with a leading part of the elements
+   appended. In addition,
+
+      size_t Name##_getSize(Name##_T oArray);
+
+   returns the number of bytes that oArray occupies. */
+
+#define DYNARRAY_DEFINE_BTREE(Name, Type, uLeafSize, uBranchSize)       \
+                                                                        \
+/* A leaf: a run of consecutive elements. */                            \
+                                                                        \
+struct Name##Leaf                                                       \
+{                                                                       \
+   /* The number of elements in the leaf. */                            \
+   size_t uLength;                                                      \
+   /* The next leaf in order, or NULL if this is the last. */           \
+   struct Name##Leaf *psNext;                                           \
+   /* The elements. */                                                  \
+   Type aElements[uLeafSize];                                           \
+};                                                                      \
+                                                                        \
+/* A branch: the roots of consecutive subtrees. */                      \
+                                                                        \
+struct Name##Branch                                                     \
+{                                                                       \
+   /* The number of children. */                                        \
+   size_t uLength;                                                      \
+   /* The number of elements below each child. */                       \
+   size_t auCounts[uBranchSize];                                        \
+   /* The last element below each child. */                             \
+   Type aLast[uBranchSize];                                             \
+   /* The children, which are leaves if the branch is on the lowest     \
+      level of branches and branches otherwise. */                      \
+   void *apvChildren[uBranchSize];                                      \
+};                                                                      \
+                                                                        \
+typedef struct Name                                                     \
+{                                                                       \
+   /* The number of elements from the client's point of view. */        \
+   size_t uLength;                                                      \
+   /* The number of levels of branches above the leaves. */             \
+   size_t uHeight;                                                      \
+   /* The root, which is a leaf if uHeight is 0 and a branch            \
+      otherwise, or NULL if the array is empty. */                      \
+   void *pvRoot;                                                        \
+   /* The number of leaves. */                                          \
+   size_t uNumLeaves;                                                   \
+   /* The number of branches. */                                        \
+   size_t uNumBranches;                                                 \
+   /* The leaf that Name##_get last visited, or NULL if the array has   \
+      changed since. */                                                 \
+   struct Name##Leaf *psFinger;                                         \
+   /* The index of the first element of psFinger. */                    \
+   size_t uFingerStart;                                                 \
+} *Name##_T;                                                            \
+                                                                        \
+static DYNARRAY_UNUSED Name##_T Name##_new(void)                        \
+{                                                                       \
+   Name##_T oArray;                                                     \
+                                                                        \
+   oArray = (Name##_T)Alloc_calloc(1, sizeof(struct Name));             \
+   return oArray;                                                       \
+}                                                                       \
+                                                                        \
+/* Free pvNode and every node below it. pvNode is a leaf if uLevel is   \
+   0 and a branch otherwise, as for each function below that takes      \
+   a level. */                                                          \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_freeNode(void *pvNode,               \
+                                            size_t uLevel)              \
+{                                                                       \
+   struct Name##Branch *psBranch;                                       \
+   size_t u;                                                            \
+                                                                        \
+   assert(pvNode != NULL);                                              \
+                                                                        \
+   if (uLevel > 0)                                                      \
+   {                                                                    \
+      psBranch = (struct Name##Branch *)pvNode;                         \
+      for (u = 0; u < psBranch->uLength; u++)                           \
+         Name##_freeNode(psBranch->apvChildren[u], uLevel - 1);         \
+   }                                                                    \
+   Alloc_free(pvNode);                                                  \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_free(Name##_T oArray)                \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   if (oArray->pvRoot != NULL)                                          \
+      Name##_freeNode(oArray->pvRoot, oArray->uHeight);                 \
+   Alloc_free(oArray);                                                  \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED size_t Name##_getLength(Name##_T oArray)         \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   return oArray->uLength;                                              \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED size_t Name##_getSize(Name##_T oArray)           \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   return sizeof(struct Name)                                           \
+      + oArray->uNumLeaves * sizeof(struct Name##Leaf)                  \
+      + oArray->uNumBranches * sizeof(struct Name##Branch);             \
+}                                                                       \
+                                                                        \
+/* Return the address of the length of pvNode. */                       \
+                                                                        \
+static DYNARRAY_UNUSED size_t *Name##_lengthOf(void *pvNode,            \
+                                               size_t uLevel)           \
+{                                                                       \
+   assert(pvNode != NULL);                                              \
+                                                                        \
+   if (uLevel == 0)                                                     \
+      return &((struct Name##Leaf *)pvNode)->uLength;                   \
+   return &((struct Name##Branch *)pvNode)->uLength;                    \
+}                                                                       \
+                                                                        \
+/* Return the last element below pvNode, which must not be empty. */    \
+                                                                        \
+static DYNARRAY_UNUSED Type Name##_lastOf(void *pvNode, size_t uLevel)  \
+{                                                                       \
+   struct Name##Leaf *psLeaf;                                           \
+   struct Name##Branch *psBranch;                                       \
+                                                                        \
+   assert(pvNode != NULL);                                              \
+                                                                        \
+   if (uLevel == 0)                                                     \
+   {                                                                    \
+      psLeaf = (struct Name##Leaf *)pvNode;                             \
+      return psLeaf->aElements[psLeaf->uLength - 1];                    \
+   }                                                                    \
+   psBranch = (struct Name##Branch *)pvNode;                            \
+   return psBranch->aLast[psBranch->uLength - 1];                       \
+}                                                                       \
+                                                                        \
+/* Set the count and last element that psBranch records for its         \
+   uSlot'th child from the child itself, whose level is uLevel. */      \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_refresh(                             \
+   struct Name##Branch *psBranch, size_t uSlot, size_t uLevel)          \
+{                                                                       \
+   struct Name##Branch *psChild;                                        \
+   size_t uCount = 0;                                                   \
+   size_t u;                                                            \
+                                                                        \
+   assert(psBranch != NULL);                                            \
+   assert(uSlot < psBranch->uLength);                                   \
+                                                                        \
+   if (uLevel == 0)                                                     \
+      uCount = ((struct Name##Leaf *)                                   \
+                psBranch->apvChildren[uSlot])->uLength;                 \
+   else                                                                 \
+   {                                                                    \
+      psChild = (struct Name##Branch *)psBranch->apvChildren[uSlot];    \
+      for (u = 0; u < psChild->uLength; u++)                            \
+         uCount += psChild->auCounts[u];                                \
+   }                                                                    \
+   psBranch->auCounts[uSlot] = uCount;                                  \
+   psBranch->aLast[uSlot] =                                             \
+      Name##_lastOf(psBranch->apvChildren[uSlot], uLevel);              \
+}                                                                       \
+                                                                        \
+/* Move uCount entries (elements if uLevel is 0, and children with      \
+   their counts and last elements otherwise) from index uFrom of        \
+   pvFrom to index uTo of pvTo, which may be the same node. Neither     \
+   node's length changes. */                                            \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_moveEntries(void *pvTo, size_t uTo,  \
+                                               void *pvFrom,            \
+                                               size_t uFrom,            \
+                                               size_t uCount,           \
+                                               size_t uLevel)           \
+{                                                                       \
+   struct Name##Branch *psTo;                                           \
+   struct Name##Branch *psFrom;                                         \
+                                                                        \
+   assert(pvTo != NULL);                                                \
+   assert(pvFrom != NULL);                                              \
+                                                                        \
+   if (uLevel == 0)                                                     \
+   {                                                                    \
+      memmove(&((struct Name##Leaf *)pvTo)->aElements[uTo],             \
+              &((struct Name##Leaf *)pvFrom)->aElements[uFrom],         \
+              sizeof(Type) * uCount);                                   \
+      return;                                                           \
+   }                                                                    \
+   psTo = (struct Name##Branch *)pvTo;                                  \
+   psFrom = (struct Name##Branch *)pvFrom;                              \
+   memmove(&psTo->auCounts[uTo], &psFrom->auCounts[uFrom],              \
+           sizeof(size_t) * uCount);                                    \
+   memmove(&psTo->aLast[uTo], &psFrom->aLast[uFrom],                    \
+           sizeof(Type) * uCount);                                      \
+   memmove(&psTo->apvChildren[uTo], &psFrom->apvChildren[uFrom],        \
+           sizeof(void *) * uCount);                                    \
+}                                                                       \
+                                                                        \
+/* Return the leaf that holds the uIndex'th element of oArray, or the   \
+   last leaf if uIndex is oArray's length, and set *puOffset to the     \
+   element's index within it. Set apsPath[uLevel] to the branch on      \
+   each level on the way down and auSlots[uLevel] to the child taken    \
+   there. oArray must not be empty. */                                  \
+                                                                        \
+static DYNARRAY_UNUSED struct Name##Leaf *Name##_descend(               \
+   Name##_T oArray, size_t uIndex, struct Name##Branch **apsPath,       \
+   size_t *auSlots, size_t *puOffset)                                   \
+{                                                                       \
+   struct Name##Branch *psBranch;                                       \
+   void *pvNode;                                                        \
+   size_t uLevel;                                                       \
+   size_t u;                                                            \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(oArray->pvRoot != NULL);                                      \
+   assert(uIndex <= oArray->uLength);                                   \
+                                                                        \
+   pvNode = oArray->pvRoot;                                             \
+   for (uLevel = oArray->uHeight; uLevel > 0; uLevel--)                 \
+   {                                                                    \
+      psBranch = (struct Name##Branch *)pvNode;                         \
+      for (u = 0; u + 1 < psBranch->uLength &&                          \
+              uIndex >= psBranch->auCounts[u]; u++)                     \
+         uIndex -= psBranch->auCounts[u];                               \
+      apsPath[uLevel] = psBranch;                                       \
+      auSlots[uLevel] = u;                                              \
+      pvNode = psBranch->apvChildren[u];                                \
+   }                                                                    \
+   *puOffset = uIndex;                                                  \
+   return (struct Name##Leaf *)pvNode;                                  \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED Type Name##_get(Name##_T oArray, size_t uIndex)  \
+{                                                                       \
+   struct Name##Branch *psBranch;                                       \
+   struct Name##Leaf *psLeaf;                                           \
+   void *pvNode;                                                        \
+   size_t uStart = 0;                                                   \
+   size_t uLevel;                                                       \
+   size_t u;                                                            \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(uIndex < oArray->uLength);                                    \
+                                                                        \
+   /* An element of the last leaf visited, or of the leaf after it,     \
+      needs no search. Remembering the leaf makes this a write, so      \
+      concurrent calls on one array race. */                            \
+   psLeaf = oArray->psFinger;                                           \
+   if (psLeaf != NULL && uIndex >= oArray->uFingerStart)                \
+   {                                                                    \
+      u = uIndex - oArray->uFingerStart;                                \
+      if (u < psLeaf->uLength)                                          \
+         return psLeaf->aElements[u];                                   \
+      if (u == psLeaf->uLength && psLeaf->psNext != NULL)               \
+      {                                                                 \
+         oArray->uFingerStart = uIndex;                                 \
+         oArray->psFinger = psLeaf->psNext;                             \
+         return oArray->psFinger->aElements[0];                         \
+      }                                                                 \
+   }                                                                    \
+                                                                        \
+   pvNode = oArray->pvRoot;                                             \
+   for (uLevel = oArray->uHeight; uLevel > 0; uLevel--)                 \
+   {                                                                    \
+      psBranch = (struct Name##Branch *)pvNode;                         \
+      for (u = 0; uIndex - uStart >= psBranch->auCounts[u]; u++)        \
+         uStart += psBranch->auCounts[u];                               \
+      pvNode = psBranch->apvChildren[u];                                \
+   }                                                                    \
+   oArray->psFinger = (struct Name##Leaf *)pvNode;                      \
+   oArray->uFingerStart = uStart;                                       \
+   return oArray->psFinger->aElements[uIndex - uStart];                 \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_addAt(Name##_T oArray, size_t uIndex, \
+                                        Type element)                   \
+{                                                                       \
+   struct Name##Branch *apsPath[DYNARRAY_BTREE_MAX_HEIGHT + 1];         \
+   size_t auSlots[DYNARRAY_BTREE_MAX_HEIGHT + 1];                       \
+   struct Name##Branch *apsSpare[DYNARRAY_BTREE_MAX_HEIGHT + 1];        \
+   size_t uNumSpare = 0;                                                \
+   size_t uNextSpare = 0;                                               \
+   struct Name##Leaf *psLeaf;                                           \
+   struct Name##Leaf *psNewLeaf = NULL;                                 \
+   struct Name##Branch *psBranch;                                       \
+   struct Name##Branch *psNewBranch;                                    \
+   void *pvSplit = NULL;                                                \
+   size_t uOffset;                                                      \
+   size_t uMove;                                                        \
+   size_t uLevel;                                                       \
+   size_t uSlot;                                                        \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(uIndex <= oArray->uLength);                                   \
+                                                                        \
+   /* The first element gets the first leaf. */                         \
+   if (oArray->pvRoot == NULL)                                          \
+   {                                                                    \
+      psLeaf = (struct Name##Leaf *)                                    \
+         Alloc_malloc(sizeof(struct Name##Leaf));                       \
+      if (psLeaf == NULL)                                               \
+         return 0;                                                      \
+      psLeaf->uLength = 0;                                              \
+      psLeaf->psNext = NULL;                                            \
+      oArray->pvRoot = psLeaf;                                          \
+      oArray->uNumLeaves = 1;                                           \
+   }                                                                    \
+                                                                        \
+   psLeaf = Name##_descend(oArray, uIndex, apsPath, auSlots, &uOffset); \
+                                                                        \
+   /* Allocate every node that splitting full nodes on the way up       \
+      will need before changing anything, so that running out of        \
+      memory leaves oArray unchanged. Each full branch needs a          \
+      sibling, and a full root a new root as well. */                   \
+   if (psLeaf->uLength == uLeafSize)                                    \
+   {                                                                    \
+      psNewLeaf = (struct Name##Leaf *)                                 \
+         Alloc_malloc(sizeof(struct Name##Leaf));                       \
+      if (psNewLeaf == NULL)                                            \
+         return 0;                                                      \
+      for (uLevel = 1; uLevel > oArray->uHeight ||                      \
+              apsPath[uLevel]->uLength == uBranchSize; uLevel++)        \
+      {                                                                 \
+         apsSpare[uNumSpare] = (struct Name##Branch *)                  \
+            Alloc_malloc(sizeof(struct Name##Branch));                  \
+         if (apsSpare[uNumSpare] == NULL)                               \
+         {                                                              \
+            while (uNumSpare > 0)                                       \
+               Alloc_free(apsSpare[--uNumSpare]);                       \
+            Alloc_free(psNewLeaf);                                      \
+            return 0;                                                   \
+         }                                                              \
+         uNumSpare++;                                                   \
+         if (uLevel > oArray->uHeight)                                  \
+            break;                                                      \
+      }                                                                 \
+   }                                                                    \
+                                                                        \
+   /* Split a full leaf, moving its upper half to a new leaf, or        \
+      moving nothing if element goes at its end, so that elements       \
+      added in order leave full leaves behind. */                       \
+   if (psNewLeaf != NULL)                                               \
+   {                                                                    \
+      if (uOffset == uLeafSize)                                         \
+         uMove = 0;                                                     \
+      else                                                              \
+         uMove = uLeafSize - uLeafSize / 2;                             \
+      memcpy(psNewLeaf->aElements,                                      \
+             &psLeaf->aElements[uLeafSize - uMove],                     \
+             sizeof(Type) * uMove);                                     \
+      psNewLeaf->uLength = uMove;                                       \
+      psLeaf->uLength -= uMove;                                         \
+      psNewLeaf->psNext = psLeaf->psNext;                               \
+      psLeaf->psNext = psNewLeaf;                                       \
+      oArray->uNumLeaves++;                                             \
+      pvSplit = psNewLeaf;                                              \
+                                                                        \
+      if (uOffset > psLeaf->uLength || uMove == 0)                      \
+      {                                                                 \
+         uOffset -= psLeaf->uLength;                                    \
+         psLeaf = psNewLeaf;                                            \
+      }                                                                 \
+   }                                                                    \
+   memmove(&psLeaf->aElements[uOffset + 1],                             \
+           &psLeaf->aElements[uOffset],                                 \
+           sizeof(Type) * (psLeaf->uLength - uOffset));                 \
+   psLeaf->aElements[uOffset] = element;                                \
+   psLeaf->uLength++;                                                   \
+                                                                        \
+   /* Then update each branch on the way up, linking in the new         \
+      sibling from the level below, if any. */                          \
+   for (uLevel = 1; uLevel <= oArray->uHeight; uLevel++)                \
+   {                                                                    \
+      psBranch = apsPath[uLevel];                                       \
+      uSlot = auSlots[uLevel];                                          \
+      if (pvSplit == NULL)                                              \
+      {                                                                 \
+         psBranch->auCounts[uSlot]++;                                   \
+         psBranch->aLast[uSlot] =                                       \
+            Name##_lastOf(psBranch->apvChildren[uSlot], uLevel - 1);    \
+         continue;                                                      \
+      }                                                                 \
+      Name##_refresh(psBranch, uSlot, uLevel - 1);                      \
+      uSlot++;                                                          \
+                                                                        \
+      /* Split a full branch evenly, so that every branch but the root  \
+         keeps at least two children. */                                \
+      psNewBranch = NULL;                                               \
+      if (psBranch->uLength == uBranchSize)                             \
+      {                                                                 \
+         psNewBranch = apsSpare[uNextSpare++];                          \
+         uMove = uBranchSize - uBranchSize / 2;                         \
+         Name##_moveEntries(psNewBranch, 0, psBranch,                   \
+                            uBranchSize - uMove, uMove, uLevel);        \
+         psNewBranch->uLength = uMove;                                  \
+         psBranch->uLength -= uMove;                                    \
+         oArray->uNumBranches++;                                        \
+         if (uSlot > psBranch->uLength)                                 \
+         {                                                              \
+            uSlot -= psBranch->uLength;                                 \
+            psBranch = psNewBranch;                                     \
+         }                                                              \
+      }                                                                 \
+      Name##_moveEntries(psBranch, uSlot + 1, psBranch, uSlot,          \
+                         psBranch->uLength - uSlot, uLevel);            \
+      psBranch->apvChildren[uSlot] = pvSplit;                           \
+      psBranch->uLength++;                                              \
+      Name##_refresh(psBranch, uSlot, uLevel - 1);                      \
+      pvSplit = psNewBranch;                                            \
+   }                                                                    \
+                                                                        \
+   /* A split root gets a new root above it. */                         \
+   if (pvSplit != NULL)                                                 \
+   {                                                                    \
+      psBranch = apsSpare[uNextSpare++];                                \
+      psBranch->uLength = 2;                                            \
+      psBranch->apvChildren[0] = oArray->pvRoot;                        \
+      psBranch->apvChildren[1] = pvSplit;                               \
+      Name##_refresh(psBranch, 0, oArray->uHeight);                     \
+      Name##_refresh(psBranch, 1, oArray->uHeight);                     \
+      oArray->pvRoot = psBranch;                                        \
+      oArray->uHeight++;                                                \
+      oArray->uNumBranches++;                                           \
+   }                                                                    \
+   assert(uNextSpare == uNumSpare);                                     \
+                                                                        \
+   oArray->uLength++;                                                   \
+   oArray->psFinger = NULL;                                             \
+   return 1;                                                            \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_add(Name##_T oArray, Type element)    \
+{                                                                       \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   return Name##_addAt(oArray, oArray->uLength, element);               \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED int Name##_appendArray(Name##_T oArray,          \
+                                              const Type *paElements,   \
+                                              size_t uCount)            \
+{                                                                       \
+   size_t u;                                                            \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(paElements != NULL || uCount == 0);                           \
+                                                                        \
+   for (u = 0; u < uCount; u++)                                         \
+      if (! Name##_addAt(oArray, oArray->uLength, paElements[u]))       \
+         return 0;                                                      \
+   return 1;                                                            \
+}                                                                       \
+                                                                        \
+/* The uSlot'th child of psBranch, whose level is uLevel, has become    \
+   too small: merge it with a neighbor if they fit in one node, and     \
+   otherwise share their entries evenly between them. */                \
+                                                                        \
+static DYNARRAY_UNUSED void Name##_rebalance(                           \
+   Name##_T oArray, struct Name##Branch *psBranch, size_t uSlot,        \
+   size_t uLevel)                                                       \
+{                                                                       \
+   void *pvLeft;                                                        \
+   void *pvRight;                                                       \
+   size_t uLeftLength;                                                  \
+   size_t uRightLength;                                                 \
+   size_t uNewLeft;                                                     \
+   size_t uLeft;                                                        \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(psBranch != NULL);                                            \
+   assert(psBranch->uLength >= 2);                                      \
+                                                                        \
+   /* Pair the child with its right neighbor, or with its left          \
+      neighbor if it is the last child. */                              \
+   if (uSlot + 1 < psBranch->uLength)                                   \
+      uLeft = uSlot;                                                    \
+   else                                                                 \
+      uLeft = uSlot - 1;                                                \
+   pvLeft = psBranch->apvChildren[uLeft];                               \
+   pvRight = psBranch->apvChildren[uLeft + 1];                          \
+   uLeftLength = *Name##_lengthOf(pvLeft, uLevel);                      \
+   uRightLength = *Name##_lengthOf(pvRight, uLevel);                    \
+                                                                        \
+   if (uLeftLength + uRightLength                                       \
+       <= (uLevel == 0 ? uLeafSize : uBranchSize))                      \
+   {                                                                    \
+      Name##_moveEntries(pvLeft, uLeftLength, pvRight, 0, uRightLength, \
+                         uLevel);                                       \
+      *Name##_lengthOf(pvLeft, uLevel) += uRightLength;                 \
+      if (uLevel == 0)                                                  \
+      {                                                                 \
+         ((struct Name##Leaf *)pvLeft)->psNext =                        \
+            ((struct Name##Leaf *)pvRight)->psNext;                     \
+         oArray->uNumLeaves--;                                          \
+      }                                                                 \
+      else                                                              \
+         oArray->uNumBranches--;                                        \
+      Alloc_free(pvRight);                                              \
+                                                                        \
+      psBranch->auCounts[uLeft] += psBranch->auCounts[uLeft + 1];       \
+      psBranch->aLast[uLeft] = Name##_lastOf(pvLeft, uLevel);           \
+      Name##_moveEntries(psBranch, uLeft + 1, psBranch, uLeft + 2,      \
+                         psBranch->uLength - uLeft - 2, uLevel + 1);    \
+      psBranch->uLength--;                                              \
+      return;                                                           \
+   }                                                                    \
+                                                                        \
+   uNewLeft = (uLeftLength + uRightLength) / 2;                         \
+   if (uLeftLength > uNewLeft)                                          \
+   {                                                                    \
+      Name##_moveEntries(pvRight, uLeftLength - uNewLeft, pvRight, 0,   \
+                         uRightLength, uLevel);                         \
+      Name##_moveEntries(pvRight, 0, pvLeft, uNewLeft,                  \
+                         uLeftLength - uNewLeft, uLevel);               \
+   }                                                                    \
+   else                                                                 \
+   {                                                                    \
+      Name##_moveEntries(pvLeft, uLeftLength, pvRight, 0,               \
+                         uNewLeft - uLeftLength, uLevel);               \
+      Name##_moveEntries(pvRight, 0, pvRight, uNewLeft - uLeftLength,   \
+                         uRightLength - (uNewLeft - uLeftLength),       \
+                         uLevel);                                       \
+   }                                                                    \
+   *Name##_lengthOf(pvRight, uLevel) =                                  \
+      uLeftLength + uRightLength - uNewLeft;                            \
+   *Name##_lengthOf(pvLeft, uLevel) = uNewLeft;                         \
+   Name##_refresh(psBranch, uLeft, uLevel);                             \
+   Name##_refresh(psBranch, uLeft + 1, uLevel);                         \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED Type Name##_removeAt(Name##_T oArray,            \
+                                            size_t uIndex)              \
+{                                                                       \
+   struct Name##Branch *apsPath[DYNARRAY_BTREE_MAX_HEIGHT + 1];         \
+   size_t auSlots[DYNARRAY_BTREE_MAX_HEIGHT + 1];                       \
+   struct Name##Leaf *psLeaf;                                           \
+   struct Name##Branch *psBranch;                                       \
+   void *pvChild;                                                       \
+   Type oldElement;                                                     \
+   size_t uOffset;                                                      \
+   size_t uLevel;                                                       \
+   size_t uSlot;                                                        \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(uIndex < oArray->uLength);                                    \
+                                                                        \
+   psLeaf = Name##_descend(oArray, uIndex, apsPath, auSlots, &uOffset); \
+   oldElement = psLeaf->aElements[uOffset];                             \
+   psLeaf->uLength--;                                                   \
+   memmove(&psLeaf->aElements[uOffset],                                 \
+           &psLeaf->aElements[uOffset + 1],                             \
+           sizeof(Type) * (psLeaf->uLength - uOffset));                 \
+                                                                        \
+   /* Keep leaves nonempty and every node at least a quarter full, so   \
+      that removals cannot leave many tiny nodes. */                    \
+   for (uLevel = 1; uLevel <= oArray->uHeight; uLevel++)                \
+   {                                                                    \
+      psBranch = apsPath[uLevel];                                       \
+      uSlot = auSlots[uLevel];                                          \
+      psBranch->auCounts[uSlot]--;                                      \
+      pvChild = psBranch->apvChildren[uSlot];                           \
+      if (*Name##_lengthOf(pvChild, uLevel - 1)                         \
+          < (uLevel == 1 ? uLeafSize : uBranchSize) / 4)                \
+         Name##_rebalance(oArray, psBranch, uSlot, uLevel - 1);         \
+      else                                                              \
+         psBranch->aLast[uSlot] = Name##_lastOf(pvChild, uLevel - 1);   \
+   }                                                                    \
+                                                                        \
+   /* A root branch with one child gives way to that child, and an      \
+      empty root leaf is freed. */                                      \
+   while (oArray->uHeight > 0 &&                                        \
+          ((struct Name##Branch *)oArray->pvRoot)->uLength == 1)        \
+   {                                                                    \
+      psBranch = (struct Name##Branch *)oArray->pvRoot;                 \
+      oArray->pvRoot = psBranch->apvChildren[0];                        \
+      Alloc_free(psBranch);                                             \
+      oArray->uHeight--;                                                \
+      oArray->uNumBranches--;                                           \
+   }                                                                    \
+   if (oArray->uHeight == 0 &&                                          \
+       ((struct Name##Leaf *)oArray->pvRoot)->uLength == 0)             \
+   {                                                                    \
+      Alloc_free(oArray->pvRoot);                                       \
+      oArray->pvRoot = NULL;                                            \
+      oArray->uNumLeaves = 0;                                           \
+   }                                                                    \
+                                                                        \
+   oArray->uLength--;                                                   \
+   oArray->psFinger = NULL;                                             \
+   return oldElement;                                                   \
+}                                                                       \
+                                                                        \
+static DYNARRAY_UNUSED size_t Name##_shrink(Name##_T oArray)            \
+{                                                                       \
+   struct Name sNew;                                                    \
+   struct Name##Leaf *psLeaf;                                           \
+   void *pvNode;                                                        \
+   size_t uLevel;                                                       \
+   size_t uOldSize;                                                     \
+   size_t u;                                                            \
+                                                                        \
+   assert(oArray != NULL);                                              \
+                                                                        \
+   if (oArray->uNumLeaves                                               \
+       <= 2 * ((oArray->uLength + uLeafSize - 1) / uLeafSize))          \
+      return 0;                                                         \
+                                                                        \
+   /* Build a new tree from the old one's leaves, in order. */          \
+   sNew.uLength = 0;                                                    \
+   sNew.uHeight = 0;                                                    \
+   sNew.pvRoot = NULL;                                                  \
+   sNew.uNumLeaves = 0;                                                 \
+   sNew.uNumBranches = 0;                                               \
+   sNew.psFinger = NULL;                                                \
+   sNew.uFingerStart = 0;                                               \
+                                                                        \
+   pvNode = oArray->pvRoot;                                             \
+   for (uLevel = oArray->uHeight; uLevel > 0; uLevel--)                 \
+      pvNode = ((struct Name##Branch *)pvNode)->apvChildren[0];         \
+   for (psLeaf = (struct Name##Leaf *)pvNode; psLeaf != NULL;           \
+        psLeaf = psLeaf->psNext)                                        \
+      for (u = 0; u < psLeaf->uLength; u++)                             \
+         if (! Name##_add(&sNew, psLeaf->aElements[u]))                 \
+         {                                                              \
+            if (sNew.pvRoot != NULL)                                    \
+               Name##_freeNode(sNew.pvRoot, sNew.uHeight);              \
+            return 0;                                                   \
+         }                                                              \
+                                                                        \
+   uOldSize = Name##_getSize(oArray);                                   \
+   if (Name##_getSize(&sNew) >= uOldSize)                               \
+   {                                                                    \
+      Name##_freeNode(sNew.pvRoot, sNew.uHeight);                       \
+      return 0;                                                         \
+   }                                                                    \
+   Name##_freeNode(oArray->pvRoot, oArray->uHeight);                    \
+   *oArray = sNew;                                                      \
+   return uOldSize - Name##_getSize(oArray);                            \
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Generate
+
+      int Function(Name##_T oArray, KeyType key, size_t *puIndex);
+
+   which binary searches oArray, an array generated by
+   DYNARRAY_DEFINE_BTREE(Name, ...), for key as DynArray_bsearch
+   does. Compare(element, key) must return <0, 0, or >0 if element is
+   less than, equal to, or greater than key, and oArray must be sorted
+   accordingly. */
+
+#define DYNARRAY_DEFINE_BTREE_BSEARCH(Name, Function, KeyType, Compare) \
+                                                                        \
+static int Function(Name##_T oArray, KeyType key, size_t *puIndex)      \
+{                                                                       \
+   struct Name##Branch *psBranch;                                       \
+   struct Name##Leaf *psLeaf;                                           \
+   void *pvNode;                                                        \
+   size_t uStart = 0;                                                   \
+   size_t uLevel;                                                       \
+   size_t uLo;                                                          \
+   size_t uHi;                                                          \
+   size_t uMid;                                                         \
+   size_t uBase;                                                        \
+   size_t uLength;                                                      \
+   size_t uHalf;                                                        \
+   size_t u;                                                            \
+                                                                        \
+   assert(oArray != NULL);                                              \
+   assert(puIndex != NULL);                                             \
+                                                                        \
+   if (oArray->pvRoot == NULL)                                          \
+   {                                                                    \
+      *puIndex = 0;                                                     \
+      return 0;                                                         \
+   }                                                                    \
+                                                                        \
+   /* In each branch, find the first child whose last element is not    \
+      less than key, skipping the elements before it. */                \
+   pvNode = oArray->pvRoot;                                             \
+   for (uLevel = oArray->uHeight; uLevel > 0; uLevel--)                 \
+   {                                                                    \
+      psBranch = (struct Name##Branch *)pvNode;                         \
+      uLo = 0;                                                          \
+      uHi = psBranch->uLength;                                          \
+      while (uLo < uHi)                                                 \
+      {                                                                 \
+         uMid = uLo + (uHi - uLo) / 2;                                  \
+         if (Compare(psBranch->aLast[uMid], key) < 0)                   \
+            uLo = uMid + 1;                                             \
+         else                                                           \
+            uHi = uMid;                                                 \
+      }                                                                 \
+      if (uLo == psBranch->uLength)                                     \
+      {                                                                 \
+         *puIndex = oArray->uLength;                                    \
+         return 0;                                                      \
+      }                                                                 \
+      for (u = 0; u < uLo; u++)                                         \
+         uStart += psBranch->auCounts[u];                               \
+      pvNode = psBranch->apvChildren[uLo];                              \
+   }                                                                    \
+                                                                        \
+   /* Then search within the leaf branchlessly, as above. */            \
+   psLeaf = (struct Name##Leaf *)pvNode;                                \
+   uBase = 0;                                                           \
+   uLength = psLeaf->uLength;                                           \
+   while (uLength > 1)                                                  \
+   {                                                                    \
+      uHalf = uLength / 2;                                              \
+      uBase += (size_t)                                                 \
+         (Compare(psLeaf->aElements[uBase + uHalf - 1], key) < 0)       \
+         * uHalf;                                                       \
+      uLength -= uHalf;                                                 \
+   }                                                                    \
+   uBase += (size_t)(Compare(psLeaf->aElements[uBase], key) < 0);       \
+                                                                        \
+   *puIndex = uStart + uBase;                                           \
+   return uBase < psLeaf->uLength &&                                    \
+      Compare(psLeaf->aElements[uBase], key) == 0;                      \
+}
+
+#endif
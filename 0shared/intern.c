@@ -0,0 +1,430 @@
+/*--------------------------------------------------------------------*/
+/* intern.c                                                           */
+/* Author: Kok Wei Pua and Cherie Jiraphanphong                       */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "intern.h"
+
+/* The initial number of slots in the hash table */
+enum { MIN_SLOTS = 64 };
+
+/* One distinct interned string */
+struct internEntry {
+   /* The number of references to the string's identifier */
+   size_t ulRefCount;
+   /* The string's hash value */
+   size_t ulHash;
+   /* The string length of pcStr */
+   size_t ulLength;
+   /* The '\0'-terminated string, stored just after this header */
+   const char *pcStr;
+};
+
+/*
+  The intern table is an AO with the following state variables:
+*/
+
+/* 1. the entries, indexed by identifier, with NULL for an identifier
+      that is free to be reused */
+static struct internEntry **ppsEntries;
+/* 2. the number of identifiers handed out, free or not, which is
+      also the next new identifier */
+static size_t ulNumEntries;
+/* 3. the allocated length of ppsEntries and of puiFreeIDs */
+static size_t ulEntriesLength;
+/* 4. a stack of the free identifiers below ulNumEntries */
+static unsigned int *puiFreeIDs;
+/* 5. the number of identifiers in puiFreeIDs */
+static size_t ulNumFree;
+/* 6. an open-addressing hash table of identifiers plus one (0 means
+      an empty slot), with a power-of-two number of slots */
+static unsigned int *puiSlots;
+/* 7. the number of slots in puiSlots */
+static size_t ulNumSlots;
+/* 8. usage statistics for Intern_getStats */
+static size_t ulHits, ulMisses, ulBytesSaved;
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the FNV-1a hash of the ulLength characters at pcStr. */
+static size_t Intern_hash(const char *pcStr, size_t ulLength) {
+   size_t ulHash = (size_t)2166136261UL;
+   size_t ul;
+
+   assert(pcStr != NULL);
+
+   for(ul = 0; ul < ulLength; ul++) {
+      ulHash ^= (unsigned char)pcStr[ul];
+      ulHash *= (size_t)16777619UL;
+   }
+   return ulHash;
+}
+
+/*
+  Replaces the hash table with one of ulNewNumSlots slots, a power of
+  two with room for every entry, and reinserts every entry. Returns
+  SUCCESS, or MEMORY_ERROR if memory could not be allocated, in which
+  case the table is unchanged.
+*/
+static int Intern_resizeSlots(size_t ulNewNumSlots) {
+   size_t ulID, ulSlot;
+   unsigned int *puiNewSlots;
+
+   assert(ulNewNumSlots > ulNumEntries - ulNumFree);
+
+   puiNewSlots = Alloc_calloc(ulNewNumSlots, sizeof(unsigned int));
+   if(puiNewSlots == NULL)
+      return MEMORY_ERROR;
+
+   for(ulID = 0; ulID < ulNumEntries; ulID++) {
+      if(ppsEntries[ulID] == NULL)
+         continue;
+      ulSlot = ppsEntries[ulID]->ulHash & (ulNewNumSlots - 1);
+      while(puiNewSlots[ulSlot] != 0)
+         ulSlot = (ulSlot + 1) & (ulNewNumSlots - 1);
+      puiNewSlots[ulSlot] = (unsigned int)(ulID + 1);
+   }
+
+   Alloc_free(puiSlots);
+   puiSlots = puiNewSlots;
+   ulNumSlots = ulNewNumSlots;
+   return SUCCESS;
+}
+
+/*
+  Grows ppsEntries and puiFreeIDs to make room for one more identifier.
+  Returns SUCCESS, or MEMORY_ERROR if memory could not be allocated.
+*/
+static int Intern_growEntries(void) {
+   struct internEntry **ppsNewEntries;
+   unsigned int *puiNewFreeIDs;
+   size_t ulNewLength;
+
+   if(ulEntriesLength == 0)
+      ulNewLength = MIN_SLOTS;
+   else
+      ulNewLength = 2 * ulEntriesLength;
+
+   /* the lengths are only recorded once both arrays have grown */
+   ppsNewEntries =
+      Alloc_realloc(ppsEntries,
+                    ulNewLength * sizeof(struct internEntry *));
+   if(ppsNewEntries == NULL)
+      return MEMORY_ERROR;
+   ppsEntries = ppsNewEntries;
+
+   puiNewFreeIDs =
+      Alloc_realloc(puiFreeIDs, ulNewLength * sizeof(unsigned int));
+   if(puiNewFreeIDs == NULL)
+      return MEMORY_ERROR;
+   puiFreeIDs = puiNewFreeIDs;
+
+   ulEntriesLength = ulNewLength;
+   return SUCCESS;
+}
+
+/*
+  Removes identifier uiID, whose entry is still in place, from the hash
+  table, moving back any later identifiers of its probe run that could
+  no longer be reached past the emptied slot.
+*/
+static void Intern_unlink(unsigned int uiID) {
+   size_t ulMask, ulHole, ulNext, ulHome;
+
+   assert(uiID < ulNumEntries);
+   assert(ppsEntries[uiID] != NULL);
+
+   ulMask = ulNumSlots - 1;
+   ulHole = ppsEntries[uiID]->ulHash & ulMask;
+   while(puiSlots[ulHole] != uiID + 1)
+      ulHole = (ulHole + 1) & ulMask;
+
+   ulNext = (ulHole + 1) & ulMask;
+   while(puiSlots[ulNext] != 0) {
+      /* an identifier may fill the hole only if the hole lies between
+         its home slot and where it is now */
+      ulHome = ppsEntries[puiSlots[ulNext] - 1]->ulHash & ulMask;
+      if(((ulNext - ulHome) & ulMask) >= ((ulNext - ulHole) & ulMask)) {
+         puiSlots[ulHole] = puiSlots[ulNext];
+         ulHole = ulNext;
+      }
+      ulNext = (ulNext + 1) & ulMask;
+   }
+   puiSlots[ulHole] = 0;
+}
+
+/*
+  Frees the table's arrays, but not the entries, and leaves the table
+  empty. Keeps the statistics.
+*/
+static void Intern_freeTable(void) {
+   Alloc_free(ppsEntries);
+   Alloc_free(puiFreeIDs);
+   Alloc_free(puiSlots);
+
+   ppsEntries = NULL;
+   ulNumEntries = 0;
+   ulEntriesLength = 0;
+   puiFreeIDs = NULL;
+   ulNumFree = 0;
+   puiSlots = NULL;
+   ulNumSlots = 0;
+}
+
+/*
+  Probes the hash table for the ulLength characters at pcStr, whose
+  hash value is ulHash. Returns the identifier plus one if the string
+  is interned, or 0 if not, and sets *pulSlot to the slot where the
+  probe stopped. The table must have at least one empty slot.
+*/
+static unsigned int Intern_probe(const char *pcStr, size_t ulLength,
+                                 size_t ulHash, size_t *pulSlot) {
+   struct internEntry *psEntry;
+   size_t ulSlot;
+
+   assert(pcStr != NULL);
+   assert(pulSlot != NULL);
+
+   ulSlot = ulHash & (ulNumSlots - 1);
+   while(puiSlots[ulSlot] != 0) {
+      psEntry = ppsEntries[puiSlots[ulSlot] - 1];
+      if(psEntry->ulHash == ulHash && psEntry->ulLength == ulLength &&
+         memcmp(psEntry->pcStr, pcStr, ulLength) == 0)
+         break;
+      ulSlot = (ulSlot + 1) & (ulNumSlots - 1);
+   }
+   *pulSlot = ulSlot;
+   return puiSlots[ulSlot];
+}
+
+/*--------------------------------------------------------------------*/
+
+int Intern_string(const char *pcStr, size_t ulLength,
+                  unsigned int *puiID) {
+   struct internEntry *psEntry;
+   size_t ulHash, ulSlot, ulNewNumSlots;
+   unsigned int uiID;
+   char *pcCopy;
+
+   assert(pcStr != NULL);
+   assert(puiID != NULL);
+
+   /* probe for the string first, so that finding one needs no room */
+   ulHash = Intern_hash(pcStr, ulLength);
+   if(ulNumSlots != 0 &&
+      Intern_probe(pcStr, ulLength, ulHash, &ulSlot) != 0) {
+      ulHits++;
+      ulBytesSaved += ulLength + 1;
+      *puiID = puiSlots[ulSlot] - 1;
+      ppsEntries[*puiID]->ulRefCount++;
+      return SUCCESS;
+   }
+
+   /* not found: keep the table at most half full with the new entry,
+      and find the empty slot again if the table was rebuilt */
+   if(2 * (ulNumEntries - ulNumFree + 1) > ulNumSlots) {
+      if(ulNumSlots == 0)
+         ulNewNumSlots = MIN_SLOTS;
+      else
+         ulNewNumSlots = 2 * ulNumSlots;
+      if(Intern_resizeSlots(ulNewNumSlots) != SUCCESS)
+         return MEMORY_ERROR;
+      (void) Intern_probe(pcStr, ulLength, ulHash, &ulSlot);
+   }
+
+   /* reuse a free identifier, or else hand out a new one */
+   if(ulNumFree == 0) {
+      if(ulNumEntries >= UINT_MAX - 1)
+         return MEMORY_ERROR;
+      if(ulNumEntries == ulEntriesLength &&
+         Intern_growEntries() != SUCCESS)
+         return MEMORY_ERROR;
+   }
+
+   psEntry = Alloc_malloc(sizeof(struct internEntry) + ulLength + 1);
+   if(psEntry == NULL)
+      return MEMORY_ERROR;
+   pcCopy = (char *)(psEntry + 1);
+   memcpy(pcCopy, pcStr, ulLength);
+   pcCopy[ulLength] = '\0';
+   psEntry->ulRefCount = 1;
+   psEntry->ulHash = ulHash;
+   psEntry->ulLength = ulLength;
+   psEntry->pcStr = pcCopy;
+
+   if(ulNumFree > 0)
+      uiID = puiFreeIDs[--ulNumFree];
+   else
+      uiID = (unsigned int)ulNumEntries++;
+   ppsEntries[uiID] = psEntry;
+   puiSlots[ulSlot] = uiID + 1;
+   *puiID = uiID;
+   ulMisses++;
+
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Intern_retain(unsigned int uiID) {
+   assert(uiID < ulNumEntries);
+   assert(ppsEntries[uiID] != NULL);
+
+   ppsEntries[uiID]->ulRefCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Intern_release(unsigned int uiID) {
+   assert(uiID < ulNumEntries);
+   assert(ppsEntries[uiID] != NULL);
+   assert(ppsEntries[uiID]->ulRefCount > 0);
+
+   if(--ppsEntries[uiID]->ulRefCount > 0)
+      return;
+
+   Intern_unlink(uiID);
+   Alloc_free(ppsEntries[uiID]);
+   ppsEntries[uiID] = NULL;
+   puiFreeIDs[ulNumFree++] = uiID;
+
+   /* once nothing is interned, give back the whole table */
+   if(ulNumFree == ulNumEntries)
+      Intern_freeTable();
+}
+
+/*--------------------------------------------------------------------*/
+
+boolean Intern_find(const char *pcStr, size_t ulLength,
+                    unsigned int *puiID) {
+   unsigned int uiFound;
+   size_t ulSlot;
+
+   assert(pcStr != NULL);
+   assert(puiID != NULL);
+
+   if(ulNumSlots == 0)
+      return FALSE;
+
+   uiFound = Intern_probe(pcStr, ulLength,
+                          Intern_hash(pcStr, ulLength), &ulSlot);
+   if(uiFound == 0)
+      return FALSE;
+
+   *puiID = uiFound - 1;
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *Intern_getString(unsigned int uiID) {
+   assert(uiID < ulNumEntries);
+   assert(ppsEntries[uiID] != NULL);
+
+   return ppsEntries[uiID]->pcStr;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Intern_getLength(unsigned int uiID) {
+   assert(uiID < ulNumEntries);
+   assert(ppsEntries[uiID] != NULL);
+
+   return ppsEntries[uiID]->ulLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Intern_getStats(size_t *pulHits, size_t *pulMisses,
+                     size_t *pulBytesSaved) {
+   assert(pulHits != NULL);
+   assert(pulMisses != NULL);
+   assert(pulBytesSaved != NULL);
+
+   *pulHits = ulHits;
+   *pulMisses = ulMisses;
+   *pulBytesSaved = ulBytesSaved;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Intern_trim(void) {
+   size_t ulFreed, ulOldNumSlots, ulNewNumSlots, ulLive, ulIndex, ulKept;
+   struct internEntry **ppsNewEntries;
+   unsigned int *puiNewFreeIDs;
+
+   if(ulNumEntries == 0)
+      return 0;
+
+   ulFreed = 0;
+
+   /* free identifiers at the end need not be kept */
+   while(ppsEntries[ulNumEntries - 1] == NULL)
+      ulNumEntries--;
+   ulKept = 0;
+   for(ulIndex = 0; ulIndex < ulNumFree; ulIndex++)
+      if(puiFreeIDs[ulIndex] < ulNumEntries)
+         puiFreeIDs[ulKept++] = puiFreeIDs[ulIndex];
+   ulNumFree = ulKept;
+
+   /* shrink the arrays only once they are mostly empty, so that a
+      table that shrinks and grows again is not reallocated each
+      time; a failed reallocation just keeps the larger array.
+      ulEntriesLength must not exceed the length of either array, so
+      it becomes the shorter one's: the free identifiers are shrunk
+      first, and if the entries then cannot be, they stay longer than
+      recorded, which is harmless */
+   if(4 * ulNumEntries <= ulEntriesLength &&
+      ulEntriesLength > MIN_SLOTS) {
+      puiNewFreeIDs = Alloc_realloc(puiFreeIDs, ulNumEntries
+                                    * sizeof(unsigned int));
+      if(puiNewFreeIDs != NULL) {
+         puiFreeIDs = puiNewFreeIDs;
+         ulFreed += (ulEntriesLength - ulNumEntries)
+            * sizeof(unsigned int);
+         ppsNewEntries = Alloc_realloc(ppsEntries, ulNumEntries
+                                       * sizeof(struct internEntry *));
+         if(ppsNewEntries != NULL) {
+            ppsEntries = ppsNewEntries;
+            ulFreed += (ulEntriesLength - ulNumEntries)
+               * sizeof(struct internEntry *);
+         }
+         ulEntriesLength = ulNumEntries;
+      }
+   }
+
+   ulLive = ulNumEntries - ulNumFree;
+   if(8 * ulLive < ulNumSlots && ulNumSlots > MIN_SLOTS) {
+      ulNewNumSlots = MIN_SLOTS;
+      while(ulNewNumSlots < 2 * (ulLive + 1))
+         ulNewNumSlots *= 2;
+      ulOldNumSlots = ulNumSlots;
+      if(Intern_resizeSlots(ulNewNumSlots) == SUCCESS)
+         ulFreed += (ulOldNumSlots - ulNumSlots) * sizeof(unsigned int);
+   }
+
+   return ulFreed;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Intern_reset(void) {
+   size_t ulID;
+
+   /* a bulk allocator releases the entries without being asked */
+   if(!Alloc_isBulk()) {
+      for(ulID = 0; ulID < ulNumEntries; ulID++)
+         Alloc_free(ppsEntries[ulID]);
+   }
+   Intern_freeTable();
+
+   ulHits = 0;
+   ulMisses = 0;
+   ulBytesSaved = 0;
+}
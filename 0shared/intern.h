@@ -0,0 +1,90 @@
+/*--------------------------------------------------------------------*/
+/* intern.h                                                           */
+/* Author: Kok Wei Pua and Cherie Jiraphanphong                       */
+/*--------------------------------------------------------------------*/
+
+#ifndef INTERN_INCLUDED
+#define INTERN_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  The intern table is a single, process-wide collection of distinct
+  component strings. Each string interned is assigned a compact 32-bit
+  identifier, so that two interned strings are equal if and only if
+  their identifiers are, and the table stores one copy of each string
+  no matter how many paths contain it. Identifiers are reference
+  counted: a string is removed once the last reference to it is
+  released, and its identifier may then be reused for another.
+*/
+
+/*
+  Interns the ulLength characters at pcStr, which need not be
+  '\0'-terminated, and sets *puiID to the identifier of the
+  resulting string, adding one reference to it that must be released
+  with Intern_release. Returns an int SUCCESS status if successful.
+  Never fails if the string is already interned.
+  Otherwise, leaves *puiID unchanged and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+                 or if all identifiers are already in use
+*/
+int Intern_string(const char *pcStr, size_t ulLength,
+                  unsigned int *puiID);
+
+/*
+  Looks up the ulLength characters at pcStr without interning them.
+  Returns TRUE and sets *puiID to the string's identifier if it is
+  already interned. Otherwise, leaves *puiID unchanged and returns
+  FALSE. Neither allocates memory, adds a reference, nor changes the
+  statistics.
+*/
+boolean Intern_find(const char *pcStr, size_t ulLength,
+                    unsigned int *puiID);
+
+/* Adds a reference to the string with identifier uiID. */
+void Intern_retain(unsigned int uiID);
+
+/*
+  Releases a reference to the string with identifier uiID, removing
+  the string from the table once no references to it remain. Once the
+  table is empty, all of its memory is freed.
+*/
+void Intern_release(unsigned int uiID);
+
+/*
+  Returns the '\0'-terminated string that was interned with
+  identifier uiID. The string is owned by the intern table.
+*/
+const char *Intern_getString(unsigned int uiID);
+
+/* Returns the string length of the string with identifier uiID. */
+size_t Intern_getLength(unsigned int uiID);
+
+/*
+  Reports the table's usage since it was last reset: *pulHits is set
+  to the number of Intern_string calls that found their string already
+  in the table, *pulMisses to the number that added a new string, and
+  *pulBytesSaved to the number of string bytes (including each
+  terminating '\0') that those hits did not have to store again.
+*/
+void Intern_getStats(size_t *pulHits, size_t *pulMisses,
+                     size_t *pulBytesSaved);
+
+/*
+  Releases memory that the table has outgrown, such as after many of
+  its strings were removed, and returns the number of bytes released.
+  Only arrays that have become mostly empty are shrunk.
+*/
+size_t Intern_trim(void);
+
+/*
+  Frees all memory used by the intern table and resets its statistics,
+  whether or not references remain. All identifiers and strings
+  previously returned become invalid, so this must only be called once
+  no paths remain, or when the allocator set with Alloc_set releases
+  all of its memory at once.
+*/
+void Intern_reset(void);
+
+#endif
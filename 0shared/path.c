@@ -4,233 +4,714 @@
 /*--------------------------------------------------------------------*/
 
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "dynarray.h"
+#include "alloc.h"
+#include "intern.h"
 #include "path.h"
 
-/* An absolute path */
-struct path {
-   /* The string representation of the path,
+/*
+  Path_scan finds delimiters a block of SCAN_WIDTH bytes at a time:
+  Path_delimMask returns a mask of the block in which the bit at
+  SCAN_BITS*i + (SCAN_BITS-1) is set iff byte i is a '/', and no other
+  bits are set. SSE2 compares 16 bytes at once; otherwise a
+  little-endian machine tests a word at a time, and anything else
+  falls back to testing bytes individually.
+*/
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+enum { SCAN_WIDTH = 16, SCAN_BITS = 1 };
+
+static size_t Path_delimMask(const char *pcBlock) {
+   __m128i vBlock = _mm_loadu_si128((const __m128i *)pcBlock);
+   return (size_t)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(vBlock, _mm_set1_epi8('/')));
+}
+
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) \
+   && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+enum { SCAN_WIDTH = sizeof(size_t), SCAN_BITS = 8 };
+
+static size_t Path_delimMask(const char *pcBlock) {
+   /* 0x0101...01 and 0x7F7F...7F */
+   const size_t ulOnes = (size_t)-1 / 0xFF;
+   const size_t ulLow7 = ulOnes * 0x7F;
+   size_t ulWord;
+
+   memcpy(&ulWord, pcBlock, sizeof(size_t));
+   /* bytes that were '/' become zero... */
+   ulWord ^= ulOnes * '/';
+   /* ...and exactly those get their high bit set */
+   return ~(((ulWord & ulLow7) + ulLow7) | ulWord | ulLow7);
+}
+
+#else
+
+enum { SCAN_WIDTH = sizeof(size_t), SCAN_BITS = 1 };
+
+static size_t Path_delimMask(const char *pcBlock) {
+   size_t ulMask = 0;
+   size_t ul;
+
+   for(ul = 0; ul < SCAN_WIDTH; ul++)
+      if(pcBlock[ul] == '/')
+         ulMask |= (size_t)1 << ul;
+   return ulMask;
+}
+
+#endif
+
+/* The FNV-1a offset basis and prime, in 64 bits where available */
+#if ULONG_MAX > 0xFFFFFFFFUL
+#define HASH_BASIS 14695981039346656037UL
+#define HASH_PRIME 1099511628211UL
+#else
+#define HASH_BASIS 2166136261UL
+#define HASH_PRIME 16777619UL
+#endif
+
+/*
+  The number of delimiter offsets Path_new records while validating,
+  which covers the depth of almost all paths. Any further delimiters
+  are found again by Path_split.
+*/
+enum { MAX_SCAN_DELIMS = 32 };
+
+/*
+  The default size of each arena chunk, in bytes. A path too large for
+  a default chunk gets a chunk of its own.
+*/
+enum { ARENA_CHUNK_SIZE = 65536 };
+
+/* The location of one component within a path's pathname string */
+struct pathComponent {
+   /* The offset of the component's first character in the pathname */
+   size_t ulStart;
+   /* The string length of the component */
+   size_t ulLength;
+   /* The component's identifier in the intern table */
+   unsigned int uiID;
+};
+
+/*
+  The storage shared by a path and all of its prefixes. Each block is a
+  single allocation that holds, in order, this header, one struct path
+  per depth (the i'th of which represents the prefix of depth i+1, and
+  the last of which is the full path), the table of ulDepth component
+  offsets, and the pathname string. Component strings themselves are
+  shared by all paths through the intern table, and the block holds
+  one reference to each of its components' identifiers. Paths are
+  immutable, so a block is shared by reference counting rather than
+  copied, and is freed when its last reference is released. Blocks
+  allocated from an arena have no reference count and instead live
+  until the arena is reset.
+*/
+struct pathBlock {
+   /* The number of outstanding references to any path in the block,
+      or 0 if the block belongs to an arena */
+   size_t ulRefCount;
+   /* The string representation of the full path,
       which uses '/' as the component delimiter */
    const char *pcPath;
-   /* The string length of pcPath */
+   /* The number of components in the full path */
+   size_t ulDepth;
+   /* The path objects for each prefix depth, shallowest first */
+   const struct path *psPrefixes;
+   /* The offset table of the components in the path, in order */
+   const struct pathComponent *psComponents;
+};
+
+/*
+  An absolute path: the first ulDepth components of its block's path.
+  A reference to any path in a block keeps the whole block alive.
+*/
+struct path {
+   /* The block holding this path's strings and component offsets */
+   const struct pathBlock *psBlock;
+   /* The string length of the path's pathname */
    size_t ulLength;
-   /* The ordered collection of component strings in the path */
-   DynArray_T oDComponents;
+   /* The number of components in the path */
+   size_t ulDepth;
+   /* The hash of the path's pathname, as returned by Path_hash */
+   size_t ulHash;
+};
+
+/* One contiguous region of an arena's memory */
+struct arenaChunk {
+   /* The next (older) chunk in the arena, or NULL */
+   struct arenaChunk *psNext;
+   /* The number of bytes available after this header */
+   size_t ulSize;
+   /* The number of those bytes already handed out */
+   size_t ulUsed;
+};
+
+/*
+  A region from which the blocks of many paths are carved, so that
+  they can all be released at once. Chunks are kept in a list, most
+  recent first; only the first chunk is ever allocated from.
+*/
+struct pathArena {
+   /* The arena's chunks, most recent first, or NULL */
+   struct arenaChunk *psChunks;
+};
+
+/* The strictest alignment that a block's contents require */
+union arenaAlign {
+   size_t ul;
+   void *pv;
+   const char *pc;
 };
 
+/* The size of a chunk header, rounded up to keep blocks aligned */
+enum { ARENA_HEADER_SIZE =
+       (sizeof(struct arenaChunk) + sizeof(union arenaAlign) - 1)
+       / sizeof(union arenaAlign) * sizeof(union arenaAlign) };
+
 /*
-  Frees pcStr. This wrapper is used to match the requirements of the
-  callback function pointer passed to DynArray_map. pvExtra is unused.
+  Records that pcPath has a delimiter at offset ulOffset while
+  scanning: *pulStart is the offset at which the current component
+  started, *pulDepth the number of components so far, and pulDelims
+  the array of up to MAX_SCAN_DELIMS delimiter offsets.
+  Returns SUCCESS, or BAD_PATH if the component ending here is empty.
 */
-static void Path_freeString(char *pcStr, void *pvExtra) {
-   /* pcStr may be NULL, as this is a no-op to free.
-      pvExtra may be NULL, as it is unused. */
-   free(pcStr);
+static int Path_scanDelim(size_t ulOffset, size_t *pulStart,
+                          size_t *pulDepth, size_t *pulDelims) {
+   /* no leading or consecutive delimiters */
+   if(ulOffset == *pulStart)
+      return BAD_PATH;
+
+   if(*pulDepth <= MAX_SCAN_DELIMS)
+      pulDelims[*pulDepth-1] = ulOffset;
+   (*pulDepth)++;
+   *pulStart = ulOffset + 1;
+   return SUCCESS;
 }
 
 /*
-  Sets *poDComponents to be an ordered collection of component strings
-  in pcPath, or NULL if an error occurs.
+  Validates pcPath without allocating any memory, and on success sets
+  *pulLength to its string length, *pulDepth to its number of
+  components, and the first (up to MAX_SCAN_DELIMS) elements of
+  pulDelims to the offsets of its delimiters, in order.
   Returns one of the following statuses:
-  * SUCCESS if no error occurrs
+  * SUCCESS if pcPath is a well-formatted path
   * BAD_PATH if pcPath is the empty string,
              or begins or ends with a '/',
              or contains consecutive '/' delimiters
-  * MEMORY_ERROR if memory could not be allocated to complete request
 */
-static int Path_split(const char *pcPath, DynArray_T *poDComponents) {
-   const char *pcStart = pcPath;
-   const char *pcEnd = pcPath;
-   char *pcCopy;
-   DynArray_T oDSubstrings;
+static int Path_scan(const char *pcPath, size_t *pulLength,
+                     size_t *pulDepth, size_t *pulDelims) {
+   size_t ulLength, ulBase, ulMask;
+   size_t ulStart = 0;
+   size_t ulDepth = 1;
 
    assert(pcPath != NULL);
-   assert(poDComponents != NULL);
+   assert(pulLength != NULL);
+   assert(pulDepth != NULL);
+   assert(pulDelims != NULL);
+
+   ulLength = strlen(pcPath);
+
+   /* test whole blocks for delimiters at once */
+   for(ulBase = 0; ulBase + SCAN_WIDTH <= ulLength;
+       ulBase += SCAN_WIDTH) {
+      ulMask = Path_delimMask(pcPath + ulBase);
+      while(ulMask != 0) {
+         if(Path_scanDelim(
+               ulBase + (size_t)__builtin_ctzl(ulMask) / SCAN_BITS,
+               &ulStart, &ulDepth, pulDelims) != SUCCESS)
+            return BAD_PATH;
+         /* clear the lowest set bit */
+         ulMask &= ulMask - 1;
+      }
+   }
 
-   /* path cannot be empty string */
-   if(*pcPath == '\0') {
-      *poDComponents = NULL;
-      return BAD_PATH;
+   /* then the remaining bytes one at a time */
+   for(; ulBase < ulLength; ulBase++) {
+      if(pcPath[ulBase] == '/')
+         if(Path_scanDelim(ulBase, &ulStart, &ulDepth, pulDelims)
+            != SUCCESS)
+            return BAD_PATH;
    }
 
-   oDSubstrings = DynArray_new(0);
-   if(oDSubstrings == NULL) {
-      *poDComponents = NULL;
-      return MEMORY_ERROR;
+   /* path cannot be empty string, and
+      final component can't end with slash */
+   if(ulStart == ulLength)
+      return BAD_PATH;
+
+   *pulLength = ulLength;
+   *pulDepth = ulDepth;
+   return SUCCESS;
+}
+
+/*
+  Returns the number of bytes in a block for a path with string length
+  ulLength and ulDepth components.
+*/
+static size_t Path_blockSize(size_t ulLength, size_t ulDepth) {
+   return sizeof(struct pathBlock)
+      + ulDepth * sizeof(struct path)
+      + ulDepth * sizeof(struct pathComponent)
+      + ulLength + 1;
+}
+
+/*
+  Returns the number of bytes that a block for a path with string
+  length ulLength and ulDepth components takes up in an arena.
+*/
+static size_t Path_arenaBlockSize(size_t ulLength, size_t ulDepth) {
+   /* keep every block aligned */
+   return (Path_blockSize(ulLength, ulDepth)
+           + sizeof(union arenaAlign) - 1)
+      / sizeof(union arenaAlign) * sizeof(union arenaAlign);
+}
+
+/*
+  Releases the intern table references held by the first ulCount
+  entries of psBlock's component table.
+*/
+static void Path_releaseComponents(const struct pathBlock *psBlock,
+                                   size_t ulCount) {
+   size_t ulLevel;
+
+   assert(psBlock != NULL);
+
+   for(ulLevel = 0; ulLevel < ulCount; ulLevel++)
+      Intern_release(psBlock->psComponents[ulLevel].uiID);
+}
+
+/*
+  Sets up the interior pointers of the block at psBlock, which has room
+  for a path with string length ulLength and ulDepth components, and
+  gives it reference count ulRefCount. The component table and strings
+  are left for the caller to fill in. Returns psBlock.
+*/
+static struct pathBlock *Path_layout(struct pathBlock *psBlock,
+                                     size_t ulDepth,
+                                     size_t ulRefCount) {
+   struct path *psPrefixes;
+   struct pathComponent *psComponents;
+   char *pcPath;
+
+   assert(psBlock != NULL);
+   assert(ulDepth > 0);
+
+   psPrefixes = (struct path *)(psBlock + 1);
+   psComponents = (struct pathComponent *)(psPrefixes + ulDepth);
+   pcPath = (char *)(psComponents + ulDepth);
+
+   psBlock->ulRefCount = ulRefCount;
+   psBlock->pcPath = pcPath;
+   psBlock->ulDepth = ulDepth;
+   psBlock->psPrefixes = psPrefixes;
+   psBlock->psComponents = psComponents;
+
+   return psBlock;
+}
+
+/*
+  Allocates a single block for a path with string length ulLength and
+  ulDepth components, and sets up the block's interior pointers. The
+  component table and strings are left for the caller to fill in.
+  Returns the block, or NULL if memory could not be allocated.
+*/
+static struct pathBlock *Path_alloc(size_t ulLength, size_t ulDepth) {
+   struct pathBlock *psBlock;
+
+   assert(ulDepth > 0);
+
+   psBlock = Alloc_malloc(Path_blockSize(ulLength, ulDepth));
+   if(psBlock == NULL)
+      return NULL;
+
+   return Path_layout(psBlock, ulDepth, 1);
+}
+
+/*
+  Carves a block for a path with string length ulLength and ulDepth
+  components out of oArena, starting a new chunk if the current one is
+  too full, and sets up the block's interior pointers. Returns the
+  block, or NULL if memory could not be allocated.
+*/
+static struct pathBlock *Path_arenaAlloc(PathArena_T oArena,
+                                         size_t ulLength,
+                                         size_t ulDepth) {
+   struct pathBlock *psBlock;
+   struct arenaChunk *psChunk;
+   size_t ulSize, ulChunkSize;
+
+   assert(oArena != NULL);
+   assert(ulDepth > 0);
+
+   ulSize = Path_arenaBlockSize(ulLength, ulDepth);
+
+   psChunk = oArena->psChunks;
+   if(psChunk == NULL || psChunk->ulSize - psChunk->ulUsed < ulSize) {
+      ulChunkSize = ARENA_CHUNK_SIZE;
+      if(ulChunkSize < ulSize)
+         ulChunkSize = ulSize;
+      psChunk = Alloc_malloc(ARENA_HEADER_SIZE + ulChunkSize);
+      if(psChunk == NULL)
+         return NULL;
+      psChunk->psNext = oArena->psChunks;
+      psChunk->ulSize = ulChunkSize;
+      psChunk->ulUsed = 0;
+      oArena->psChunks = psChunk;
    }
 
-   /* validate and split pcPath */
-   while(*pcEnd != '\0') {
-      pcEnd = pcStart;
-      /* component can't start with delimiter */
-      if(*pcEnd == '/') {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return BAD_PATH;
-      }
+   psBlock = (struct pathBlock *)
+      ((char *)psChunk + ARENA_HEADER_SIZE + psChunk->ulUsed);
+   psChunk->ulUsed += ulSize;
+   return Path_layout(psBlock, ulDepth, 0);
+}
 
-      /* advance pcEnd to end of next token */
-      while(*pcEnd != '/' && *pcEnd != '\0')
-         pcEnd++;
-
-      /* final component can't end with slash */
-      if(*pcEnd == '\0' && *(pcEnd-1) == '/') {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return BAD_PATH;
+/*
+  Fills in psBlock's prefix paths, which requires its pathname and
+  component offset table to already be in place. Each prefix's hash
+  is the running FNV-1a hash of the pathname up to the prefix's end,
+  so all of them take a single pass over the pathname. If oPKnown is
+  not NULL, it must be a path whose pathname is a prefix of psBlock's
+  at a component boundary; its own prefixes' hashes are reused, and
+  hashing resumes where it ends.
+*/
+static void Path_setPrefixes(struct pathBlock *psBlock, Path_T oPKnown) {
+   struct path *psPrefixes;
+   size_t ulIndex;
+   size_t ulByte = 0;
+   size_t ulHash = (size_t)HASH_BASIS;
+
+   assert(psBlock != NULL);
+
+   psPrefixes = (struct path *)psBlock->psPrefixes;
+   for(ulIndex = 0; ulIndex < psBlock->ulDepth; ulIndex++) {
+      psPrefixes[ulIndex].psBlock = psBlock;
+      psPrefixes[ulIndex].ulDepth = ulIndex + 1;
+      psPrefixes[ulIndex].ulLength =
+         psBlock->psComponents[ulIndex].ulStart
+         + psBlock->psComponents[ulIndex].ulLength;
+
+      if(oPKnown != NULL && ulIndex < oPKnown->ulDepth) {
+         ulHash = oPKnown->psBlock->psPrefixes[ulIndex].ulHash;
+         ulByte = psPrefixes[ulIndex].ulLength;
       }
-
-      pcCopy = calloc((size_t)(pcEnd-pcStart+1), sizeof(char));
-      if(pcCopy == NULL) {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return MEMORY_ERROR;
+      else {
+         for(; ulByte < psPrefixes[ulIndex].ulLength; ulByte++) {
+            ulHash ^= (unsigned char)psBlock->pcPath[ulByte];
+            ulHash *= (size_t)HASH_PRIME;
+         }
       }
+      psPrefixes[ulIndex].ulHash = ulHash;
+   }
+}
 
-      if( DynArray_add(oDSubstrings, pcCopy) == 0) {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return MEMORY_ERROR;
+/*
+  Fills psBlock's component offset table from its pathname string,
+  which must already be in place, and the delimiter offsets recorded
+  in pulDelims by Path_scan, interning each component, and then fills
+  in its prefix paths. ulLength is the pathname's string length.
+  Returns SUCCESS, or MEMORY_ERROR if a component could not be
+  interned, in which case those interned so far are released.
+*/
+static int Path_split(struct pathBlock *psBlock, size_t ulLength,
+                      const size_t *pulDelims) {
+   struct pathComponent *psComponents;
+   const char *pcDelim;
+   size_t ulLevel, ulEnd;
+   size_t ulStart = 0;
+
+   assert(psBlock != NULL);
+   assert(pulDelims != NULL);
+
+   psComponents = (struct pathComponent *)psBlock->psComponents;
+
+   for(ulLevel = 0; ulLevel < psBlock->ulDepth; ulLevel++) {
+      /* find where this component ends */
+      if(ulLevel == psBlock->ulDepth - 1)
+         ulEnd = ulLength;
+      else if(ulLevel < MAX_SCAN_DELIMS)
+         ulEnd = pulDelims[ulLevel];
+      else {
+         pcDelim = memchr(psBlock->pcPath + ulStart, '/',
+                          ulLength - ulStart);
+         assert(pcDelim != NULL);
+         ulEnd = (size_t)(pcDelim - psBlock->pcPath);
       }
 
-      while(pcStart != pcEnd) {
-         *pcCopy = *pcStart;
-         pcCopy++;
-         pcStart++;
+      psComponents[ulLevel].ulStart = ulStart;
+      psComponents[ulLevel].ulLength = ulEnd - ulStart;
+      if(Intern_string(psBlock->pcPath + ulStart, ulEnd - ulStart,
+                       &psComponents[ulLevel].uiID) != SUCCESS) {
+         Path_releaseComponents(psBlock, ulLevel);
+         return MEMORY_ERROR;
       }
-
-      pcStart++;
+      ulStart = ulEnd + 1;
    }
 
-   *poDComponents = oDSubstrings;
+   Path_setPrefixes(psBlock, NULL);
    return SUCCESS;
 }
 
+/* Returns the full path stored in psBlock. */
+static Path_T Path_owner(const struct pathBlock *psBlock) {
+   assert(psBlock != NULL);
 
-int Path_new(const char *pcPath, Path_T *poPResult) {
-   struct path *psNew;
-   int iSplitResult;
+   return &psBlock->psPrefixes[psBlock->ulDepth-1];
+}
+
+
+/*
+  Does the work of Path_new and Path_newBatch: parses pcPath into a
+  block allocated from oArena, or from the heap if oArena is NULL.
+  Returns and sets *poPResult as Path_new does.
+*/
+static int Path_parse(const char *pcPath, PathArena_T oArena,
+                      Path_T *poPResult) {
+   struct pathBlock *psBlock;
+   size_t ulLength, ulDepth;
+   size_t aulDelims[MAX_SCAN_DELIMS];
+   int iStatus;
 
    assert(pcPath != NULL);
    assert(poPResult != NULL);
 
-   psNew = calloc(1, sizeof(struct path));
-   if(psNew == NULL) {
+   /* validate pcPath and find its delimiters before allocating */
+   iStatus = Path_scan(pcPath, &ulLength, &ulDepth, aulDelims);
+   if(iStatus != SUCCESS) {
       *poPResult = NULL;
-      return MEMORY_ERROR;
+      return iStatus;
    }
 
-   /* instantiate and fill list of components */
-   iSplitResult = Path_split(pcPath, &psNew->oDComponents);
-   if(iSplitResult != SUCCESS) {
-      Path_free(psNew);
+   if(oArena == NULL)
+      psBlock = Path_alloc(ulLength, ulDepth);
+   else
+      psBlock = Path_arenaAlloc(oArena, ulLength, ulDepth);
+   if(psBlock == NULL) {
       *poPResult = NULL;
-      return iSplitResult;
+      return MEMORY_ERROR;
    }
 
-   psNew->ulLength = strlen(pcPath);
-   psNew->pcPath = malloc(psNew->ulLength+1);
-   if(psNew->pcPath == NULL) {
-      Path_free(psNew);
+   memcpy((char *)psBlock->pcPath, pcPath, ulLength + 1);
+   iStatus = Path_split(psBlock, ulLength, aulDelims);
+   if(iStatus != SUCCESS) {
+      /* an arena block is the last one carved from the arena's
+         current chunk, so hand its space back; a reset must not find
+         it, as it holds no components */
+      if(oArena == NULL)
+         Alloc_free(psBlock);
+      else
+         oArena->psChunks->ulUsed -=
+            Path_arenaBlockSize(ulLength, ulDepth);
       *poPResult = NULL;
-      return MEMORY_ERROR;
+      return iStatus;
    }
-   strcpy((char *)psNew->pcPath, pcPath);
 
-   *poPResult = psNew;
+   *poPResult = Path_owner(psBlock);
    return SUCCESS;
 }
 
+int Path_new(const char *pcPath, Path_T *poPResult) {
+   assert(pcPath != NULL);
+   assert(poPResult != NULL);
+
+   return Path_parse(pcPath, NULL, poPResult);
+}
+
+int Path_newBatch(const char *const *ppcPaths, size_t ulCount,
+                  PathArena_T oArena, Path_T *poPResults,
+                  int *piStatuses) {
+   size_t ul;
+   int iResult = SUCCESS;
+
+   assert(ppcPaths != NULL || ulCount == 0);
+   assert(oArena != NULL);
+   assert(poPResults != NULL || ulCount == 0);
+   assert(piStatuses != NULL || ulCount == 0);
+
+   for(ul = 0; ul < ulCount; ul++) {
+      assert(ppcPaths[ul] != NULL);
+      piStatuses[ul] = Path_parse(ppcPaths[ul], oArena, &poPResults[ul]);
+
+      /* report a memory failure ahead of any malformed path */
+      if(piStatuses[ul] == MEMORY_ERROR)
+         iResult = MEMORY_ERROR;
+      else if(piStatuses[ul] != SUCCESS && iResult == SUCCESS)
+         iResult = piStatuses[ul];
+   }
+
+   return iResult;
+}
+
+int PathArena_new(PathArena_T *poArenaResult) {
+   assert(poArenaResult != NULL);
+
+   *poArenaResult = Alloc_malloc(sizeof(struct pathArena));
+   if(*poArenaResult == NULL)
+      return MEMORY_ERROR;
+
+   (*poArenaResult)->psChunks = NULL;
+   return SUCCESS;
+}
+
+/*
+  Releases the intern table references held by every block carved from
+  psChunk, which lie one after another from its start.
+*/
+static void Path_releaseChunk(struct arenaChunk *psChunk) {
+   const struct pathBlock *psBlock;
+   size_t ulOffset = 0;
+
+   assert(psChunk != NULL);
+
+   while(ulOffset < psChunk->ulUsed) {
+      psBlock = (const struct pathBlock *)
+         ((char *)psChunk + ARENA_HEADER_SIZE + ulOffset);
+      Path_releaseComponents(psBlock, psBlock->ulDepth);
+      ulOffset += Path_arenaBlockSize(Path_owner(psBlock)->ulLength,
+                                      psBlock->ulDepth);
+   }
+}
+
+void PathArena_reset(PathArena_T oArena) {
+   struct arenaChunk *psChunk;
+   struct arenaChunk *psNext;
+
+   assert(oArena != NULL);
+
+   if(oArena->psChunks == NULL)
+      return;
+
+   for(psChunk = oArena->psChunks; psChunk != NULL;
+       psChunk = psChunk->psNext)
+      Path_releaseChunk(psChunk);
+
+   /* keep the most recent chunk for the next batch */
+   psChunk = oArena->psChunks->psNext;
+   while(psChunk != NULL) {
+      psNext = psChunk->psNext;
+      Alloc_free(psChunk);
+      psChunk = psNext;
+   }
+   oArena->psChunks->psNext = NULL;
+   oArena->psChunks->ulUsed = 0;
+}
+
+void PathArena_free(PathArena_T oArena) {
+   if(oArena != NULL) {
+      PathArena_reset(oArena);
+      Alloc_free(oArena->psChunks);
+      Alloc_free(oArena);
+   }
+}
+
 int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
-   struct path *psNew;
-   size_t ulIndex, ulLength, ulSum;
-   const char *pcComponent;
-   char *pcCopy;
-   char *pcBuild;
-   char *pcInsert;
+   struct pathBlock *psBlock;
+   const struct pathBlock *psOld;
+   size_t ulLength, ulLevel;
+   int iStatus;
 
    assert(oPPath != NULL);
    assert(poPResult != NULL);
 
-   /* cannot build empty path */
-   if(ulDepth == 0) {
-      *poPResult = NULL;
-      return NO_SUCH_PATH;
-   }
+   /* find the prefix within oPPath's own block */
+   iStatus = Path_prefixView(oPPath, ulDepth, poPResult);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   ulLength = (*poPResult)->ulLength;
+   psOld = oPPath->psBlock;
 
-   /* cannot have a prefix longer than oPPath */
-   if(Path_getDepth(oPPath) < ulDepth) {
+   psBlock = Path_alloc(ulLength, ulDepth);
+   if(psBlock == NULL) {
       *poPResult = NULL;
-      return NO_SUCH_PATH;
+      return MEMORY_ERROR;
    }
 
-   psNew = calloc(1, sizeof(struct path));
-   if(psNew == NULL) {
+   /* the prefix shares oPPath's leading bytes and component offsets,
+      and its components are already interned */
+   memcpy((char *)psBlock->pcPath, psOld->pcPath, ulLength);
+   ((char *)psBlock->pcPath)[ulLength] = '\0';
+   memcpy((struct pathComponent *)psBlock->psComponents,
+          psOld->psComponents,
+          ulDepth * sizeof(struct pathComponent));
+   for(ulLevel = 0; ulLevel < ulDepth; ulLevel++)
+      Intern_retain(psOld->psComponents[ulLevel].uiID);
+   Path_setPrefixes(psBlock, *poPResult);
+
+   *poPResult = Path_owner(psBlock);
+   return SUCCESS;
+}
+
+int Path_child(Path_T oPParent, const char *pcComponent,
+               Path_T *poPResult) {
+   struct pathBlock *psBlock;
+   struct pathComponent *psComponents;
+   size_t ulComponentLength, ulDepth, ulLength, ulLevel;
+   char *pcInsert;
+
+   assert(oPParent != NULL);
+   assert(pcComponent != NULL);
+   assert(poPResult != NULL);
+
+   /* the component must be a non-empty string without delimiters */
+   ulComponentLength = strlen(pcComponent);
+   if(ulComponentLength == 0 ||
+      memchr(pcComponent, '/', ulComponentLength) != NULL) {
       *poPResult = NULL;
-      return MEMORY_ERROR;
+      return BAD_PATH;
    }
 
-   psNew->oDComponents = DynArray_new(ulDepth);
-   if(psNew->oDComponents == NULL) {
-      Path_free(psNew);
+   ulDepth = oPParent->ulDepth + 1;
+   ulLength = oPParent->ulLength + 1 + ulComponentLength;
+   psBlock = Path_alloc(ulLength, ulDepth);
+   if(psBlock == NULL) {
       *poPResult = NULL;
       return MEMORY_ERROR;
    }
 
-   pcBuild = calloc(Path_getStrLength(oPPath)+1, sizeof(char));
-   if(pcBuild == NULL) {
-      Path_free(psNew);
+   /* append the component to oPParent's pathname */
+   pcInsert = (char *)psBlock->pcPath;
+   memcpy(pcInsert, oPParent->psBlock->pcPath, oPParent->ulLength);
+   pcInsert += oPParent->ulLength;
+   *pcInsert = '/';
+   memcpy(pcInsert + 1, pcComponent, ulComponentLength + 1);
+
+   /* oPParent's components are already interned; only the new one
+      needs to be */
+   psComponents = (struct pathComponent *)psBlock->psComponents;
+   memcpy(psComponents, oPParent->psBlock->psComponents,
+          oPParent->ulDepth * sizeof(struct pathComponent));
+   psComponents[ulDepth-1].ulStart = oPParent->ulLength + 1;
+   psComponents[ulDepth-1].ulLength = ulComponentLength;
+   if(Intern_string(pcComponent, ulComponentLength,
+                    &psComponents[ulDepth-1].uiID) != SUCCESS) {
+      Alloc_free(psBlock);
       *poPResult = NULL;
       return MEMORY_ERROR;
    }
+   for(ulLevel = 0; ulLevel < oPParent->ulDepth; ulLevel++)
+      Intern_retain(psComponents[ulLevel].uiID);
+   Path_setPrefixes(psBlock, oPParent);
 
-   pcInsert = pcBuild;
-   ulSum = 0;
-
-   for(ulIndex = 0; ulIndex < ulDepth; ulIndex++) {
-      /* deep copy each component to new DynArray */
-      pcComponent = Path_getComponent(oPPath, ulIndex);
-      ulLength = strlen(pcComponent);
-      pcCopy = calloc(ulLength + 1, sizeof(char));
-      if(pcCopy == NULL) {
-         free(pcBuild);
-         Path_free(psNew);
-         *poPResult = NULL;
-         return MEMORY_ERROR;
-      }
-      strcpy(pcCopy, pcComponent);
-      (void) DynArray_set(psNew->oDComponents, ulIndex, pcCopy);
-      /* construct prefix's pathname string */
-      strcpy(pcInsert, pcComponent);
-      pcInsert[ulLength] = '/';
-      ulSum += ulLength + 1;
-      pcInsert += ulLength + 1;
-   }
-   pcBuild[ulSum-1] = '\0';
+   *poPResult = Path_owner(psBlock);
+   return SUCCESS;
+}
 
-   /* shrink allocation to fit prefix's pathname string if needed */
-   pcInsert = realloc(pcBuild, ulSum);
-   if(pcInsert == NULL) {
-      free(pcBuild);
-      Path_free(psNew);
+int Path_prefixView(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
+   assert(oPPath != NULL);
+   assert(poPResult != NULL);
+
+   /* cannot build empty path, or
+      a prefix longer than oPPath */
+   if(ulDepth == 0 || oPPath->ulDepth < ulDepth) {
       *poPResult = NULL;
-      return MEMORY_ERROR;
+      return NO_SUCH_PATH;
    }
-   psNew->ulLength = ulSum-1;
-   psNew->pcPath = pcInsert;
 
-   *poPResult = psNew;
+   *poPResult = &oPPath->psBlock->psPrefixes[ulDepth-1];
    return SUCCESS;
 }
 
@@ -238,26 +719,49 @@ int Path_dup(Path_T oPPath, Path_T *poPResult) {
    assert(oPPath != NULL);
    assert(poPResult != NULL);
 
+   /* a full path is immutable and terminated, so it can be shared,
+      unless it will disappear with its arena */
+   if(oPPath == Path_owner(oPPath->psBlock) &&
+      oPPath->psBlock->ulRefCount > 0) {
+      *poPResult = Path_retain(oPPath);
+      return SUCCESS;
+   }
+
+   /* a view's pathname isn't terminated, so copy it out */
    return Path_prefix(oPPath, Path_getDepth(oPPath), poPResult);
 }
 
+Path_T Path_retain(Path_T oPPath) {
+   assert(oPPath != NULL);
+
+   /* arena paths aren't reference counted */
+   if(oPPath->psBlock->ulRefCount > 0)
+      ((struct pathBlock *)oPPath->psBlock)->ulRefCount++;
+   return oPPath;
+}
+
 void Path_free(Path_T oPPath) {
-   if(oPPath != NULL) {
-      free((char *)oPPath->pcPath);
+   struct pathBlock *psBlock;
 
-      if(oPPath->oDComponents != NULL) {
-         DynArray_map(oPPath->oDComponents,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oPPath->oDComponents);
+   if(oPPath != NULL) {
+      psBlock = (struct pathBlock *)oPPath->psBlock;
+
+      /* the block holds the path and all of its prefixes, and
+         arena blocks are released only with their arena */
+      if(psBlock->ulRefCount > 0) {
+         psBlock->ulRefCount--;
+         if(psBlock->ulRefCount == 0) {
+            Path_releaseComponents(psBlock, psBlock->ulDepth);
+            Alloc_free(psBlock);
+         }
       }
    }
-   free((struct path*) oPPath);
 }
 
 const char *Path_getPathname(Path_T oPPath) {
    assert(oPPath != NULL);
 
-   return oPPath->pcPath;
+   return oPPath->psBlock->pcPath;
 }
 
 size_t Path_getStrLength(Path_T oPPath) {
@@ -267,23 +771,80 @@ size_t Path_getStrLength(Path_T oPPath) {
 }
 
 int Path_comparePath(Path_T oPPath1, Path_T oPPath2) {
+   size_t ulMin;
+   int iCompare;
+
+   assert(oPPath1 != NULL);
+   assert(oPPath2 != NULL);
+
+   /* paths sharing a block are prefixes of one another, so the
+      shallower one sorts first without looking at the pathnames */
+   if(oPPath1->psBlock == oPPath2->psBlock) {
+      if(oPPath1->ulDepth < oPPath2->ulDepth)
+         return -1;
+      return oPPath1->ulDepth > oPPath2->ulDepth;
+   }
+
+   /* pathnames are bounded by length, since views aren't terminated */
+   if(oPPath1->ulLength < oPPath2->ulLength)
+      ulMin = oPPath1->ulLength;
+   else
+      ulMin = oPPath2->ulLength;
+
+   iCompare = memcmp(oPPath1->psBlock->pcPath, oPPath2->psBlock->pcPath,
+                     ulMin);
+   if(iCompare != 0)
+      return iCompare;
+
+   /* a proper prefix sorts first, as with strcmp */
+   if(oPPath1->ulLength < oPPath2->ulLength)
+      return -1;
+   return oPPath1->ulLength > oPPath2->ulLength;
+}
+
+boolean Path_equals(Path_T oPPath1, Path_T oPPath2) {
    assert(oPPath1 != NULL);
    assert(oPPath2 != NULL);
 
-   return strcmp(oPPath1->pcPath, oPPath2->pcPath);
+   if(oPPath1->psBlock == oPPath2->psBlock)
+      return (boolean) (oPPath1->ulDepth == oPPath2->ulDepth);
+
+   /* most unequal paths differ in length or hash */
+   if(oPPath1->ulLength != oPPath2->ulLength ||
+      oPPath1->ulHash != oPPath2->ulHash)
+      return FALSE;
+
+   return (boolean) (memcmp(oPPath1->psBlock->pcPath,
+                            oPPath2->psBlock->pcPath,
+                            oPPath1->ulLength) == 0);
+}
+
+size_t Path_hash(Path_T oPPath) {
+   assert(oPPath != NULL);
+
+   return oPPath->ulHash;
 }
 
 int Path_compareString(Path_T oPPath, const char *pcStr) {
+   int iCompare;
+
    assert(oPPath != NULL);
    assert(pcStr != NULL);
 
-   return strcmp(oPPath->pcPath, pcStr);
+   iCompare = strncmp(oPPath->psBlock->pcPath, pcStr, oPPath->ulLength);
+   if(iCompare != 0)
+      return iCompare;
+
+   /* pcStr matched all of oPPath; it is equal only if it ends here */
+   if(pcStr[oPPath->ulLength] != '\0')
+      return -1;
+   return 0;
 }
 
 size_t Path_getDepth(Path_T oPPath) {
    assert(oPPath != NULL);
 
-   return DynArray_getLength(oPPath->oDComponents);
+   return oPPath->ulDepth;
 }
 
 size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
@@ -298,9 +859,10 @@ size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
       ulMin = ulDepth1;
    else
       ulMin = ulDepth2;
+   /* interned components are equal iff their identifiers are */
    for(i = 0; i < ulMin; i++) {
-      if(strcmp(Path_getComponent(oPPath1, i),
-                Path_getComponent(oPPath2, i)))
+      if(oPPath1->psBlock->psComponents[i].uiID !=
+         oPPath2->psBlock->psComponents[i].uiID)
          return i;
    }
    return ulMin;
@@ -312,5 +874,12 @@ const char *Path_getComponent(Path_T oPPath, size_t ulLevel) {
    if(ulLevel >= Path_getDepth(oPPath))
       return NULL;
 
-   return DynArray_get(oPPath->oDComponents, ulLevel);
+   return Intern_getString(oPPath->psBlock->psComponents[ulLevel].uiID);
+}
+
+unsigned int Path_getComponentID(Path_T oPPath, size_t ulLevel) {
+   assert(oPPath != NULL);
+   assert(ulLevel < Path_getDepth(oPPath));
+
+   return oPPath->psBlock->psComponents[ulLevel].uiID;
 }
@@ -12,6 +12,12 @@
 /* An object representing an absolute path in a tree */
 typedef const struct path * Path_T;
 
+/*
+  A caller-owned region of memory from which many paths can be
+  allocated at once and then released together
+*/
+typedef struct pathArena * PathArena_T;
+
 /*
   Creates a new path object representing the absolute path in pcPath.
   Returns an int SUCCESS status and sets *poPResult to be the new path
@@ -24,7 +30,39 @@ typedef const struct path * Path_T;
 int Path_new(const char *pcPath, Path_T *poPResult);
 
 /*
-  Creates a "deep copy" of oPPath, duplicating all its contents.
+  Parses each of the ulCount strings in ppcPaths as Path_new does, but
+  allocates the resulting paths from oArena rather than individually.
+  For each i, sets piStatuses[i] to the status Path_new would return
+  for ppcPaths[i], and poPResults[i] to the new path or to NULL.
+  Returns SUCCESS if every path was created. Otherwise returns
+  MEMORY_ERROR if any status is MEMORY_ERROR, or else BAD_PATH.
+  The new paths remain valid until oArena is reset or freed: Path_free
+  and Path_retain have no effect on them, and Path_dup gives a copy
+  that does not depend on oArena.
+*/
+int Path_newBatch(const char *const *ppcPaths, size_t ulCount,
+                  PathArena_T oArena, Path_T *poPResults,
+                  int *piStatuses);
+
+/*
+  Creates a new, empty path arena. Returns an int SUCCESS status and
+  sets *poArenaResult to be the new arena if successful. Otherwise,
+  returns MEMORY_ERROR and leaves *poArenaResult NULL.
+*/
+int PathArena_new(PathArena_T *poArenaResult);
+
+/*
+  Releases every path allocated from oArena at once, keeping some of
+  its memory to be reused by later batches.
+*/
+void PathArena_reset(PathArena_T oArena);
+
+/* Releases every path allocated from oArena, and frees oArena. */
+void PathArena_free(PathArena_T oArena);
+
+/*
+  Creates a copy of oPPath with the same contents. Since paths are
+  immutable, the copy shares oPPath's storage whenever possible.
   Returns an int SUCCESS status and sets *poPResult to be the new path
   if successful. Otherwise, sets *poPResult to NULL and returns status:
   * MEMORY_ERROR if memory could not be allocated to complete request
@@ -43,10 +81,51 @@ int Path_dup(Path_T oPPath, Path_T *poPResult);
 */
 int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult);
 
-/* Destroys and frees all memory allocated for oPPath. */
+/*
+  Creates a new path object representing the child of oPParent (which
+  may be a view from Path_prefixView) named by component pcComponent.
+  The new path reuses oPParent's already-parsed components, so only
+  pcComponent is examined.
+  Returns an int SUCCESS status and sets *poPResult to be the new path
+  if successful. Otherwise, sets *poPResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * BAD_PATH if pcComponent is the empty string or contains a '/'
+*/
+int Path_child(Path_T oPParent, const char *pcComponent,
+               Path_T *poPResult);
+
+/*
+  Sets *poPResult to a borrowed "view" of the prefix of oPPath with
+  depth ulDepth, without allocating any memory. The view shares
+  oPPath's storage, so it remains valid only as long as oPPath does,
+  unless it is kept alive with Path_retain. Use Path_prefix or Path_dup
+  to obtain a copy with its own terminated pathname.
+  Returns an int SUCCESS status if successful. Otherwise, sets
+  *poPResult to NULL and returns status:
+  * NO_SUCH_PATH if ulDepth is 0 or is greater than oPPath's depth
+*/
+int Path_prefixView(Path_T oPPath, size_t ulDepth, Path_T *poPResult);
+
+/*
+  Adds a reference to oPPath, which may be a view from Path_prefixView,
+  and returns oPPath. The reference must be released with Path_free.
+*/
+Path_T Path_retain(Path_T oPPath);
+
+/*
+  Releases a reference to oPPath obtained from Path_new, Path_prefix,
+  Path_dup, or Path_retain. Once no references to oPPath or to any
+  path sharing its storage remain, destroys and frees all memory
+  allocated for it.
+*/
 void Path_free(Path_T oPPath);
 
-/* Returns the string representation of the absolute path oPPath. */
+/*
+  Returns the string representation of the absolute path oPPath.
+  If oPPath is a view from Path_prefixView, the string is not
+  terminated at the end of the view: only its first
+  Path_getStrLength(oPPath) characters belong to oPPath.
+*/
 const char *Path_getPathname(Path_T oPPath);
 
 /*
@@ -62,6 +141,19 @@ size_t Path_getStrLength(Path_T oPPath);
 */
 int Path_comparePath(Path_T oPPath1, Path_T oPPath2);
 
+/*
+  Returns TRUE if oPPath1 and oPPath2 have the same pathname and FALSE
+  if not. This is equivalent to testing Path_comparePath for 0, but
+  most unequal paths are rejected by comparing their cached hashes.
+*/
+boolean Path_equals(Path_T oPPath1, Path_T oPPath2);
+
+/*
+  Returns a hash of oPPath's pathname, which is computed when oPPath
+  is created. Paths with equal pathnames have equal hashes.
+*/
+size_t Path_hash(Path_T oPPath);
+
 /*
   Compares oPPath's pathname with pcStr lexicographically.
   Returns <0, 0, or >0 if oPPath is "less than", "equal to", or
@@ -93,4 +185,12 @@ size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2);
 */
 const char *Path_getComponent(Path_T oPPath, size_t ulLevel);
 
+/*
+  Returns the intern table identifier of the component of oPPath at
+  level ulLevel, counting from 0 as in Path_getComponent. Two
+  components are equal if and only if their identifiers are.
+  ulLevel must be less than oPPath's depth.
+*/
+unsigned int Path_getComponentID(Path_T oPPath, size_t ulLevel);
+
 #endif
@@ -0,0 +1,224 @@
+/*--------------------------------------------------------------------*/
+/* path_client.c                                                      */
+/* Author: Kok Wei Pua and Cherie Jiraphanphong                       */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alloc.h"
+#include "intern.h"
+#include "path.h"
+
+/* TRUE while the allocator below is to fail every request. */
+static boolean bFailAllocs = FALSE;
+
+/* An allocator that passes each request on to malloc, realloc, or
+   free, except that it fails while bFailAllocs is TRUE. */
+static void *failingAlloc(size_t ulSize, void *pvContext) {
+  (void) pvContext;
+  return bFailAllocs ? NULL : malloc(ulSize);
+}
+
+static void *failingRealloc(void *pvBlock, size_t ulSize,
+                            void *pvContext) {
+  (void) pvContext;
+  return bFailAllocs ? NULL : realloc(pvBlock, ulSize);
+}
+
+static void failingFree(void *pvBlock, void *pvContext) {
+  (void) pvContext;
+  free(pvBlock);
+}
+
+/* Asserts that oPFirst and oPSecond agree in every observable way. */
+static void checkSame(Path_T oPFirst, Path_T oPSecond) {
+  size_t ulLevel;
+
+  assert(Path_getDepth(oPFirst) == Path_getDepth(oPSecond));
+  assert(Path_getStrLength(oPFirst) == Path_getStrLength(oPSecond));
+  assert(!strncmp(Path_getPathname(oPFirst), Path_getPathname(oPSecond),
+                  Path_getStrLength(oPFirst)));
+  assert(Path_hash(oPFirst) == Path_hash(oPSecond));
+  assert(Path_equals(oPFirst, oPSecond));
+  assert(Path_comparePath(oPFirst, oPSecond) == 0);
+  assert(Path_getSharedPrefixDepth(oPFirst, oPSecond) ==
+         Path_getDepth(oPFirst));
+  for(ulLevel = 0; ulLevel < Path_getDepth(oPFirst); ulLevel++) {
+    assert(!strcmp(Path_getComponent(oPFirst, ulLevel),
+                   Path_getComponent(oPSecond, ulLevel)));
+    assert(Path_getComponentID(oPFirst, ulLevel) ==
+           Path_getComponentID(oPSecond, ulLevel));
+  }
+}
+
+/*
+  Checks that extending pcParent by pcComponent with Path_child gives
+  the same path as Path_new of the joined string, both from a full
+  path and from a view of a longer one.
+*/
+static void checkChild(const char *pcParent, const char *pcComponent) {
+  enum {MAX_PATH = 256};
+  char acJoined[MAX_PATH];
+  char acLonger[MAX_PATH];
+  Path_T oPParent, oPLonger, oPView, oPExpected, oPChild;
+
+  sprintf(acJoined, "%s/%s", pcParent, pcComponent);
+  sprintf(acLonger, "%s/zzz/yyy", pcParent);
+  assert(Path_new(pcParent, &oPParent) == SUCCESS);
+  assert(Path_new(acJoined, &oPExpected) == SUCCESS);
+
+  assert(Path_child(oPParent, pcComponent, &oPChild) == SUCCESS);
+  assert(!strcmp(Path_getPathname(oPChild), acJoined));
+  checkSame(oPChild, oPExpected);
+  Path_free(oPChild);
+
+  /* a view's pathname runs on past its end */
+  assert(Path_new(acLonger, &oPLonger) == SUCCESS);
+  assert(Path_prefixView(oPLonger, Path_getDepth(oPParent), &oPView)
+         == SUCCESS);
+  assert(Path_child(oPView, pcComponent, &oPChild) == SUCCESS);
+  assert(!strcmp(Path_getPathname(oPChild), acJoined));
+  checkSame(oPChild, oPExpected);
+
+  /* the child outlives the paths it was made from */
+  Path_free(oPLonger);
+  Path_free(oPParent);
+  checkSame(oPChild, oPExpected);
+  Path_free(oPChild);
+  Path_free(oPExpected);
+}
+
+/*
+  Checks that Path_newBatch parses the ulCount strings in ppcPaths
+  into oArena with the statuses in aiExpected, returning iExpected,
+  and that each path it creates is the same as Path_new's.
+*/
+static void checkBatch(const char *const *ppcPaths, size_t ulCount,
+                       PathArena_T oArena, const int *aiExpected,
+                       int iExpected) {
+  enum {MAX_BATCH = 16};
+  Path_T aoPResults[MAX_BATCH];
+  int aiStatuses[MAX_BATCH];
+  Path_T oPExpected;
+  size_t ul;
+
+  assert(ulCount <= MAX_BATCH);
+  assert(Path_newBatch(ppcPaths, ulCount, oArena, aoPResults,
+                       aiStatuses) == iExpected);
+  for(ul = 0; ul < ulCount; ul++) {
+    assert(aiStatuses[ul] == aiExpected[ul]);
+    if(aiStatuses[ul] != SUCCESS) {
+      assert(aoPResults[ul] == NULL);
+      continue;
+    }
+    assert(Path_new(ppcPaths[ul], &oPExpected) == SUCCESS);
+    checkSame(aoPResults[ul], oPExpected);
+    Path_free(oPExpected);
+  }
+}
+
+/*
+  Checks Path_newBatch and the path arenas: malformed paths among good
+  ones, a path too large for one chunk, a batch that runs out of
+  memory partway, reuse after a reset, and that no component stays
+  interned once the arena is reset or freed.
+*/
+static void testArena(void) {
+  enum {BIG_DEPTH = 10000, BIG_COMPONENT = 8};
+  static char acBig[BIG_DEPTH * BIG_COMPONENT];
+  static const char *const apcMixed[] = {
+    "1root/2a", "", "1root//2b", "b1/b2/b3", "/1root", "1root/2c/",
+    "1root/2a"
+  };
+  static const int aiMixed[] = {
+    SUCCESS, BAD_PATH, BAD_PATH, SUCCESS, BAD_PATH, BAD_PATH, SUCCESS
+  };
+  static const char *const apcAfter[] = {"r1/r2", "1root/2a/3b"};
+  static const int aiAfter[] = {SUCCESS, SUCCESS};
+  const char *apcBig[3];
+  int aiBig[3];
+  const char *pcNew = "1root/3new";
+  char *pcNext;
+  PathArena_T oArena;
+  Path_T oPResult;
+  int iStatus;
+  unsigned int uiID;
+  size_t ul;
+
+  assert(PathArena_new(&oArena) == SUCCESS);
+  checkBatch(apcMixed, sizeof(apcMixed) / sizeof(apcMixed[0]), oArena,
+             aiMixed, BAD_PATH);
+
+  /* a path bigger than a chunk gets a chunk of its own, and the next
+     small one a new chunk again */
+  pcNext = acBig;
+  for(ul = 0; ul < BIG_DEPTH; ul++)
+    pcNext += sprintf(pcNext, "%s%06lu", ul ? "/" : "",
+                      (unsigned long) ul);
+  apcBig[0] = "s1/s2";
+  apcBig[1] = acBig;
+  apcBig[2] = "s1/s3";
+  aiBig[0] = aiBig[1] = aiBig[2] = SUCCESS;
+  checkBatch(apcBig, 3, oArena, aiBig, SUCCESS);
+  assert(Intern_find("009999", strlen("009999"), &uiID) == TRUE);
+
+  /* a path whose component cannot be interned gives its space back */
+  bFailAllocs = TRUE;
+  assert(Path_newBatch(&pcNew, 1, oArena, &oPResult, &iStatus)
+         == MEMORY_ERROR);
+  bFailAllocs = FALSE;
+  assert(iStatus == MEMORY_ERROR);
+  assert(oPResult == NULL);
+  assert(Intern_find("3new", strlen("3new"), &uiID) == FALSE);
+
+  /* a reset releases every path, and the arena is then reused */
+  PathArena_reset(oArena);
+  assert(Intern_find("1root", strlen("1root"), &uiID) == FALSE);
+  assert(Intern_find("b2", strlen("b2"), &uiID) == FALSE);
+  assert(Intern_find("009999", strlen("009999"), &uiID) == FALSE);
+  checkBatch(apcAfter, 2, oArena, aiAfter, SUCCESS);
+  checkBatch(apcMixed, sizeof(apcMixed) / sizeof(apcMixed[0]), oArena,
+             aiMixed, BAD_PATH);
+  assert(Intern_find("r2", strlen("r2"), &uiID) == TRUE);
+
+  PathArena_free(oArena);
+  assert(Intern_find("r2", strlen("r2"), &uiID) == FALSE);
+  assert(Intern_find("1root", strlen("1root"), &uiID) == FALSE);
+}
+
+/* Tests the path implementation with an assortment of checks.
+   Returns 0. */
+int main(void) {
+  Path_T oPParent, oPChild;
+  unsigned int uiID;
+
+  /* an allocator that can be made to fail, installed while no memory
+     is in use */
+  Alloc_set(failingAlloc, failingRealloc, failingFree, NULL);
+
+  checkChild("1root", "2child");
+  checkChild("1root/2child", "3gkid");
+  checkChild("1root/2child/3gkid", "2child");
+  checkChild("a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q/r/s", "t");
+  checkChild("1root", "1root");
+
+  /* a component must be non-empty and hold no delimiters */
+  assert(Path_new("1root", &oPParent) == SUCCESS);
+  assert(Path_child(oPParent, "", &oPChild) == BAD_PATH);
+  assert(oPChild == NULL);
+  assert(Path_child(oPParent, "2a/3b", &oPChild) == BAD_PATH);
+  assert(Path_child(oPParent, "/", &oPChild) == BAD_PATH);
+  Path_free(oPParent);
+
+  /* once every path is freed, no component remains interned */
+  assert(Intern_find("1root", strlen("1root"), &uiID) == FALSE);
+  assert(Intern_find("t", strlen("t"), &uiID) == FALSE);
+
+  testArena();
+
+  Alloc_set(NULL, NULL, NULL, NULL);
+  return 0;
+}
@@ -0,0 +1 @@
+../0shared/intern.c
\ No newline at end of file
@@ -66,7 +66,6 @@ static int Node_compareString(const Node_T oNFirst,
 int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult) {
    struct node *psNew;
    Path_T oPParentPath = NULL;
-   Path_T oPNewPath = NULL;
    size_t ulParentDepth;
    size_t ulIndex;
    int iStatus;
@@ -81,14 +80,8 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult) {
       return MEMORY_ERROR;
    }
 
-   /* set the new node's path */
-   iStatus = Path_dup(oPPath, &oPNewPath);
-   if(iStatus != SUCCESS) {
-      free(psNew);
-      *poNResult = NULL;
-      return iStatus;
-   }
-   psNew->oPPath = oPNewPath;
+   /* share the caller's (immutable) path rather than copying it */
+   psNew->oPPath = Path_retain(oPPath);
 
    /* validate and set the new node's parent */
    if(oNParent != NULL) {
@@ -0,0 +1 @@
+../0shared/dynarray_client.c
\ No newline at end of file
@@ -9,7 +9,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc.h"
 #include "dynarray.h"
+#include "intern.h"
 #include "path.h"
 #include "node.h"
 #include "ft.h"
@@ -26,6 +28,9 @@ static Node_T oNRoot;
 /* 3. a counter of the number of nodes in the hierarchy */
 static size_t ulCount;
 
+/* The most runs that FT_toString splits a hierarchy's nodes into */
+enum { MAX_TO_STRING_RUNS = 64 };
+
 /* --------------------------------------------------------------------
 
   The FT_traversePath and FT_findNode functions modularize the common
@@ -41,16 +46,12 @@ static size_t ulCount;
   be only a prefix of oPPath, or even NULL if the root is NULL).
   Otherwise, sets *poNFurthest to NULL and returns with status:
   * CONFLICTING_PATH if the root's path is not a prefix of oPPath
-  * MEMORY_ERROR if memory could not be allocated to complete request
 */
 static int FT_traversePath(Path_T oPPath, Node_T *poNFurthest) {
-   int iStatus;
-   Path_T oPPrefix = NULL;
    Node_T oNCurr;
    Node_T oNChild = NULL;
    size_t ulDepth;
    size_t i;
-   size_t ulChildID;
 
    assert(oPPath != NULL);
    assert(poNFurthest != NULL);
@@ -61,47 +62,28 @@ static int FT_traversePath(Path_T oPPath, Node_T *poNFurthest) {
       return SUCCESS;
    }
 
-   iStatus = Path_prefix(oPPath, 1, &oPPrefix);
-   if(iStatus != SUCCESS) {
-      *poNFurthest = NULL;
-      return iStatus;
-   }
-
-   if(Path_comparePath(Node_getPath(oNRoot), oPPrefix)) {
-      Path_free(oPPrefix);
+   /* nodes keep only their final components, so match oPPath one
+      component at a time */
+   if(Node_getName(oNRoot) != Path_getComponentID(oPPath, 0)) {
       *poNFurthest = NULL;
       return CONFLICTING_PATH;
    }
-   Path_free(oPPrefix);
-   oPPrefix = NULL;
 
    oNCurr = oNRoot;
    ulDepth = Path_getDepth(oPPath);
-   for(i = 2; i <= ulDepth; i++) {
-      iStatus = Path_prefix(oPPath, i, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         *poNFurthest = NULL;
-         return iStatus;
-      }
-      if(Node_hasChild(oNCurr, oPPrefix, &ulChildID)) {
-         /* go to that child and continue with next prefix */
-         Path_free(oPPrefix);
-         oPPrefix = NULL;
-         iStatus = Node_getChild(oNCurr, ulChildID, &oNChild);
-         if(iStatus != SUCCESS) {
-            *poNFurthest = NULL;
-            return iStatus;
-         }
+   for(i = 1; i < ulDepth; i++) {
+      if(Node_findChildID(oNCurr, Path_getComponentID(oPPath, i),
+                          &oNChild)) {
+         /* go to that child and continue with next component */
          oNCurr = oNChild;
       }
       else {
-         /* oNCurr doesn't have child with path oPPrefix:
+         /* oNCurr doesn't have child with that name:
             this is as far as we can go */
          break;
       }
    }
 
-   Path_free(oPPrefix);
    *poNFurthest = oNCurr;
    return SUCCESS;
 }
@@ -114,50 +96,64 @@ static int FT_traversePath(Path_T oPPath, Node_T *poNFurthest) {
   * BAD_PATH if pcPath does not represent a well-formatted path
   * CONFLICTING_PATH if the root's path is not a prefix of pcPath
   * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
-  * MEMORY_ERROR if memory could not be allocated to complete request
+  Since it only reads the FT, this walks pcPath's components in place
+  and compares them against child names rather than building a Path_T,
+  so it allocates no memory.
  */
 static int FT_findNode(const char *pcPath, Node_T *poNResult) {
-   Path_T oPPath = NULL;
-   Node_T oNFound = NULL;
-   int iStatus;
+   const char *pcName;
+   const char *pcDelim;
+   size_t ulLength;
+   Node_T oNCurr;
+   int iStatus = SUCCESS;
 
    assert(pcPath != NULL);
    assert(poNResult != NULL);
 
-   if(!bIsInitialized) {
-      *poNResult = NULL;
+   *poNResult = NULL;
+   if(!bIsInitialized)
       return INITIALIZATION_ERROR;
-   }
 
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS) {
-      *poNResult = NULL;
-      return iStatus;
-   }
-
-   iStatus = FT_traversePath(oPPath, &oNFound);
-   if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return iStatus;
-   }
+   /* root is NULL -> won't find anything */
+   if(oNRoot == NULL)
+      iStatus = NO_SUCH_PATH;
 
-   if(oNFound == NULL) {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return NO_SUCH_PATH;
-   }
+   /* every component must be checked, since a malformed path is
+      reported even when it leaves the tree early */
+   oNCurr = oNRoot;
+   pcName = pcPath;
+   do {
+      pcDelim = strchr(pcName, '/');
+      if(pcDelim == NULL)
+         ulLength = strlen(pcName);
+      else
+         ulLength = (size_t)(pcDelim - pcName);
+
+      /* no empty path, empty components, or trailing '/' */
+      if(ulLength == 0)
+         return BAD_PATH;
+
+      /* once the walk has left the tree, only validate */
+      if(iStatus == SUCCESS) {
+         if(pcName == pcPath) {
+            /* the root's path is its only component */
+            if(Intern_getLength(Node_getName(oNRoot)) != ulLength ||
+               strncmp(Intern_getString(Node_getName(oNRoot)), pcName,
+                       ulLength) != 0)
+               iStatus = CONFLICTING_PATH;
+         }
+         else if(!Node_findChildNamed(oNCurr, pcName, ulLength,
+                                      &oNCurr))
+            iStatus = NO_SUCH_PATH;
+      }
 
-   if(Path_comparePath(Node_getPath(oNFound), oPPath) != 0) {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return NO_SUCH_PATH;
-   }
+      if(pcDelim != NULL)
+         pcName = pcDelim + 1;
+   } while(pcDelim != NULL);
 
-   Path_free(oPPath);
-   *poNResult = oNFound;
-   return SUCCESS;
+   if(iStatus == SUCCESS)
+      *poNResult = oNCurr;
+   return iStatus;
 }
 /*--------------------------------------------------------------------*/
 
@@ -204,11 +200,11 @@ int FT_insertDir(const char *pcPath) {
    if(oNCurr == NULL) /* new root! */
       ulIndex = 1;
    else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
+      ulIndex = Node_getDepth(oNCurr)+1;
 
-      /* oNCurr is the node we're trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       Node_getPath(oNCurr))) {
+      /* oNCurr is the node we're trying to insert, since the
+         traversal matched every component of oPPath */
+      if(ulIndex == ulDepth+1) {
          Path_free(oPPath);
          return ALREADY_IN_TREE;
       }
@@ -219,8 +215,8 @@ int FT_insertDir(const char *pcPath) {
       Path_T oPPrefix = NULL;
       Node_T oNNewNode = NULL;
 
-      /* generate a Path_T for this level */
-      iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
+      /* borrow a view of oPPath for this level */
+      iStatus = Path_prefixView(oPPath, ulIndex, &oPPrefix);
       if(iStatus != SUCCESS) {
          Path_free(oPPath);
          if(oNFirstNew != NULL)
@@ -232,14 +228,12 @@ int FT_insertDir(const char *pcPath) {
       iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode, FALSE, NULL, 0);
       if(iStatus != SUCCESS) {
          Path_free(oPPath);
-         Path_free(oPPrefix);
          if(oNFirstNew != NULL)
             (void) Node_free(oNFirstNew);
          return iStatus;
       }
 
       /* set up for next level */
-      Path_free(oPPrefix);
       oNCurr = oNNewNode;
       ulNewNodes++;
       if(oNFirstNew == NULL)
@@ -351,11 +345,11 @@ int FT_insertFile(const char *pcPath, void *pvContents,
    if(oNCurr == NULL) /* new root! */
       ulIndex = 1;
    else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
+      ulIndex = Node_getDepth(oNCurr)+1;
 
-      /* oNCurr is the node we're trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       Node_getPath(oNCurr))) {
+      /* oNCurr is the node we're trying to insert, since the
+         traversal matched every component of oPPath */
+      if(ulIndex == ulDepth+1) {
          Path_free(oPPath);
          return ALREADY_IN_TREE;
       }
@@ -366,8 +360,8 @@ int FT_insertFile(const char *pcPath, void *pvContents,
       Path_T oPPrefix = NULL;
       Node_T oNPrefixNewNode = NULL;
 
-      /* generate a Path_T for this level */
-      iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
+      /* borrow a view of oPPath for this level */
+      iStatus = Path_prefixView(oPPath, ulIndex, &oPPrefix);
       if(iStatus != SUCCESS) {
          Path_free(oPPath);
          if(oNFirstNew != NULL)
@@ -379,14 +373,12 @@ int FT_insertFile(const char *pcPath, void *pvContents,
       iStatus = Node_new(oPPrefix, oNCurr, &oNPrefixNewNode, FALSE, NULL, 0);
       if(iStatus != SUCCESS) {
          Path_free(oPPath);
-         Path_free(oPPrefix);
          if(oNFirstNew != NULL)
             (void) Node_free(oNFirstNew);
          return iStatus;
       }
 
       /* set up for next level */
-      Path_free(oPPrefix);
       oNCurr = oNPrefixNewNode;
       ulNewNodes++;
       if(oNFirstNew == NULL)
@@ -542,16 +534,84 @@ int FT_destroy(void) {
    if(!bIsInitialized)
       return INITIALIZATION_ERROR;
 
-   if(oNRoot) {
+   /* a bulk allocator releases the whole tree at once, so there is
+      no need to visit each node to free it */
+   if(oNRoot && Alloc_isBulk()) {
+      ulCount = 0;
+      oNRoot = NULL;
+   }
+   else if(oNRoot) {
       ulCount -= Node_free(oNRoot);
       oNRoot = NULL;
    }
 
+   /* the nodes themselves are released a slab at a time; freeing
+      each node released its name, but nodes left to a bulk allocator
+      never did */
+   Node_releaseAll();
+   Intern_reset();
+
    bIsInitialized = FALSE;
 
    return SUCCESS;
 }
 
+int FT_setAllocator(void *(*pfAlloc)(size_t ulSize, void *pvContext),
+                    void *(*pfRealloc)(void *pvBlock, size_t ulSize,
+                                       void *pvContext),
+                    void (*pfFree)(void *pvBlock, void *pvContext),
+                    void *pvContext) {
+   /* memory from one allocator must not be freed by another */
+   if(bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   Alloc_set(pfAlloc, pfRealloc, pfFree, pvContext);
+   return SUCCESS;
+}
+
+void FT_setIndexFanout(size_t ulFanout) {
+   /* directories pick this up lazily, so it may change at any time */
+   Node_setIndexFanout(ulFanout);
+}
+
+/*
+  Releases the memory that the children arrays of every directory in
+  the subtree rooted at oNNode have outgrown. Returns the number of
+  bytes released.
+*/
+static size_t FT_trimSubtree(Node_T oNNode) {
+   size_t ulFreed;
+   size_t c;
+   Node_T oNChild = NULL;
+
+   assert(oNNode != NULL);
+
+   ulFreed = Node_trim(oNNode);
+   for(c = 0; c < Node_getNumChildren(oNNode); c++) {
+      int iStatus;
+      iStatus = Node_getChild(oNNode, c, &oNChild);
+      assert(iStatus == SUCCESS);
+      if(Node_getIsFile(oNChild) == FALSE)
+         ulFreed += FT_trimSubtree(oNChild);
+   }
+   return ulFreed;
+}
+
+int FT_trim(size_t *pulFreed) {
+   assert(pulFreed != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   *pulFreed = 0;
+   if(oNRoot != NULL)
+      *pulFreed = FT_trimSubtree(oNRoot);
+   *pulFreed += Node_trimSlabs();
+   *pulFreed += Intern_trim();
+
+   return SUCCESS;
+}
+
 /* --------------------------------------------------------------------
 
   The following auxiliary functions are used for generating the
@@ -606,27 +666,36 @@ static void FT_strlenAccumulate(Node_T oNNode, size_t *pulAcc) {
    assert(pulAcc != NULL);
 
    if(oNNode != NULL)
-      *pulAcc += (Path_getStrLength(Node_getPath(oNNode)) + 1);
+      *pulAcc += (Node_getPathLength(oNNode) + 1);
 }
 
 /*
-  Alternate version of strcat that inverts the typical argument
-  order, appending oNNode's path onto pcAcc, and also always adds one
-  newline at the end of the concatenated string.
+  Alternate version of strcpy that copies oNNode's path to *ppcAcc
+  followed by one newline, and then advances *ppcAcc past them, so
+  that each call appends to the previous one without rescanning it.
 */
-static void FT_strcatAccumulate(Node_T oNNode, char *pcAcc) {
-   assert(pcAcc != NULL);
+static void FT_strcpyAccumulate(Node_T oNNode, char **ppcAcc) {
+   size_t ulLength;
+
+   assert(ppcAcc != NULL);
+   assert(*ppcAcc != NULL);
 
+   /* a node's path is rebuilt from its ancestors' names in place */
    if(oNNode != NULL) {
-      strcat(pcAcc, Path_getPathname(Node_getPath(oNNode)));
-      strcat(pcAcc, "\n");
+      ulLength = Node_writePath(oNNode, *ppcAcc);
+      (*ppcAcc)[ulLength] = '\n';
+      *ppcAcc += ulLength + 1;
    }
 }
 /*--------------------------------------------------------------------*/
 
 char *FT_toString(void) {
    DynArray_T nodes;
+   size_t aulRunStrlens[MAX_TO_STRING_RUNS];
+   char *apcRunStarts[MAX_TO_STRING_RUNS];
    size_t totalStrlen = 1;
+   size_t ulRuns;
+   size_t ulRun;
    char *result = NULL;
 
    if(!bIsInitialized)
@@ -635,18 +704,36 @@ char *FT_toString(void) {
    nodes = DynArray_new(ulCount);
    (void) FT_preOrderTraversal(oNRoot, nodes, 0);
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strlenAccumulate,
-                (void*) &totalStrlen);
+   /* the nodes are split into one run per thread that DynArray can
+      use, each of which is measured and then copied in parallel */
+   ulRuns = DynArray_getParallelism();
+   if(ulRuns > MAX_TO_STRING_RUNS)
+      ulRuns = MAX_TO_STRING_RUNS;
+   for(ulRun = 0; ulRun < ulRuns; ulRun++)
+      aulRunStrlens[ulRun] = 0;
+   DynArray_mapParallel(nodes,
+                        (void (*)(void *, void*)) FT_strlenAccumulate,
+                        (void*) aulRunStrlens, sizeof(size_t),
+                        ulRuns);
+   for(ulRun = 0; ulRun < ulRuns; ulRun++)
+      totalStrlen += aulRunStrlens[ulRun];
 
    result = malloc(totalStrlen);
    if(result == NULL) {
       DynArray_free(nodes);
       return NULL;
    }
-   *result = '\0';
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strcatAccumulate,
-                (void *) result);
+   /* each run's paths start where the previous run's end */
+   apcRunStarts[0] = result;
+   for(ulRun = 1; ulRun < ulRuns; ulRun++)
+      apcRunStarts[ulRun] =
+         apcRunStarts[ulRun - 1] + aulRunStrlens[ulRun - 1];
+   DynArray_mapParallel(nodes,
+                        (void (*)(void *, void*)) FT_strcpyAccumulate,
+                        (void *) apcRunStarts, sizeof(char *),
+                        ulRuns);
+   result[totalStrlen - 1] = '\0';
 
    DynArray_free(nodes);
 
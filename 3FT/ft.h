@@ -134,6 +134,52 @@ int FT_init(void);
 */
 int FT_destroy(void);
 
+/*
+  Releases memory that the data structure has allocated but no longer
+  needs, and sets *pulFreed to the number of bytes released. That is
+  the room a directory had for children that have since been removed,
+  each block of node memory none of whose nodes remain in the tree,
+  and the room the table of component names had for names that no
+  path uses any longer. Space is released only once it is mostly
+  unused, so that a directory or table that shrinks and then grows
+  again is not reallocated each time. Blocks of node memory are kept
+  if the allocator releases all of its memory at once (see
+  FT_setAllocator), since it cannot take them back one at a time.
+  Returns INITIALIZATION_ERROR if not already initialized, in which
+  case *pulFreed is unchanged, and SUCCESS otherwise.
+*/
+int FT_trim(size_t *pulFreed);
+
+/*
+  Makes pfAlloc, pfRealloc, and pfFree the functions through which the
+  FT obtains and releases all of its memory, passing each pvContext as
+  its last argument, or restores malloc, realloc, and free if pfAlloc
+  is NULL. pfAlloc and pfRealloc must behave like malloc and realloc
+  (a block passed to pfRealloc is never NULL, and no size is 0).
+  pfFree may be NULL for an allocator, such as an arena, that releases
+  all of its memory at once; FT_destroy then returns in constant time
+  without visiting the tree, and the client releases the memory
+  afterward. Strings returned by FT_toString still come from malloc.
+  Returns INITIALIZATION_ERROR if the FT is in an initialized state,
+  since its memory came from the current allocator, and SUCCESS
+  otherwise.
+*/
+int FT_setAllocator(void *(*pfAlloc)(size_t ulSize, void *pvContext),
+                    void *(*pfRealloc)(void *pvBlock, size_t ulSize,
+                                       void *pvContext),
+                    void (*pfFree)(void *pvBlock, void *pvContext),
+                    void *pvContext);
+
+/*
+  Makes each directory with more than ulFanout children also keep a
+  hash index of them by name, so that finding a child along a path
+  takes constant expected time rather than a binary search over its
+  siblings. This may be called at any time, whether or not the FT is
+  initialized; directories build an index when a child is next added
+  to them and FT_trim drops ones that have shrunk well below ulFanout.
+*/
+void FT_setIndexFanout(size_t ulFanout);
+
 /*
   Returns a string representation of the
   data structure, or NULL if the structure is
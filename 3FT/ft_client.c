@@ -10,19 +10,342 @@
 #include <string.h>
 #include "ft.h"
 
+/* The number of siblings that testManySiblings inserts, enough for
+   their directory to keep them in a B+-tree with a hash index; the
+   number that it first removes them down to, still too many for an
+   ordinary array; and the number that it finally keeps, few enough
+   for FT_trim to return them to one. */
+enum {NUM_SIBLINGS = 2000, MIDDLE_SIBLINGS = 400, KEPT_SIBLINGS = 100};
+
+/* Writes to pcPath the path of the ith sibling in testManySiblings.
+   Names are zero-padded so that sorting them sorts the indices.
+   Every third sibling is a file, and the rest are directories. */
+static void siblingPath(char *pcPath, size_t i) {
+  sprintf(pcPath, "1root/s%04lu", (unsigned long) i);
+}
+
+/* Shuffles the ulLength indices at aulOrder. */
+static void shuffle(size_t aulOrder[], size_t ulLength) {
+  size_t i;
+  size_t j;
+  size_t ulTemp;
+
+  for (i = ulLength - 1; i > 0; i--) {
+    j = (size_t) rand() % (i + 1);
+    ulTemp = aulOrder[i];
+    aulOrder[i] = aulOrder[j];
+    aulOrder[j] = ulTemp;
+  }
+}
+
+/* Checks that contains* and toString report exactly the siblings i
+   for which abPresent[i] is TRUE. */
+static void checkSiblings(const boolean abPresent[]) {
+  char acPath[32];
+  char *pcExpected;
+  char *pcActual;
+  char *pcNext;
+  size_t i;
+
+  /* the files come first, then the directories, each in order */
+  pcExpected = malloc((NUM_SIBLINGS + 1) * sizeof(acPath));
+  assert(pcExpected != NULL);
+  pcNext = pcExpected + sprintf(pcExpected, "1root\n");
+  for (i = 0; i < NUM_SIBLINGS; i += 3)
+    if (abPresent[i]) {
+      siblingPath(pcNext, i);
+      pcNext = strchr(pcNext, '\0');
+      *pcNext++ = '\n';
+    }
+  for (i = 0; i < NUM_SIBLINGS; i++)
+    if (abPresent[i] && i % 3 != 0) {
+      siblingPath(pcNext, i);
+      pcNext = strchr(pcNext, '\0');
+      *pcNext++ = '\n';
+    }
+  *pcNext = '\0';
+
+  for (i = 0; i < NUM_SIBLINGS; i++) {
+    siblingPath(acPath, i);
+    assert(FT_containsFile(acPath) == (abPresent[i] && i % 3 == 0));
+    assert(FT_containsDir(acPath) == (abPresent[i] && i % 3 != 0));
+  }
+  assert((pcActual = FT_toString()) != NULL);
+  assert(!strcmp(pcActual, pcExpected));
+  free(pcActual);
+  free(pcExpected);
+}
+
+/* Inserts NUM_SIBLINGS children of one directory in a random order,
+   then removes them in another random order, first down to
+   MIDDLE_SIBLINGS and then down to KEPT_SIBLINGS, trimming the FT
+   and checking the children that remain after each step. FT must be
+   uninitialized, and is left that way. */
+static void testManySiblings(void) {
+  static size_t aulOrder[NUM_SIBLINGS];
+  static boolean abPresent[NUM_SIBLINGS];
+  char acPath[32];
+  size_t i;
+  size_t ulFreed;
+
+  assert(FT_init() == SUCCESS);
+  srand(217);
+
+  for (i = 0; i < NUM_SIBLINGS; i++)
+    aulOrder[i] = i;
+  shuffle(aulOrder, NUM_SIBLINGS);
+  for (i = 0; i < NUM_SIBLINGS; i++) {
+    siblingPath(acPath, aulOrder[i]);
+    if (aulOrder[i] % 3 == 0)
+      assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+    else
+      assert(FT_insertDir(acPath) == SUCCESS);
+    abPresent[aulOrder[i]] = TRUE;
+  }
+  checkSiblings(abPresent);
+
+  /* the siblings that come last in the new order are kept */
+  shuffle(aulOrder, NUM_SIBLINGS);
+  for (i = 0; i < NUM_SIBLINGS - KEPT_SIBLINGS; i++) {
+    siblingPath(acPath, aulOrder[i]);
+    if (aulOrder[i] % 3 == 0)
+      assert(FT_rmFile(acPath) == SUCCESS);
+    else
+      assert(FT_rmDir(acPath) == SUCCESS);
+    abPresent[aulOrder[i]] = FALSE;
+    if (i + 1 == NUM_SIBLINGS - MIDDLE_SIBLINGS ||
+        i + 1 == NUM_SIBLINGS - KEPT_SIBLINGS) {
+      assert(FT_trim(&ulFreed) == SUCCESS);
+      assert(ulFreed > 0);
+      checkSiblings(abPresent);
+    }
+  }
+
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* An allocator that passes each request on to malloc, realloc, or
+   free and counts the blocks it has handed out and not had back in
+   *pvContext, a long. */
+static void *countingAlloc(size_t ulSize, void *pvContext) {
+  void *pvBlock = malloc(ulSize);
+  if (pvBlock != NULL)
+    (*(long *) pvContext)++;
+  return pvBlock;
+}
+
+static void *countingRealloc(void *pvBlock, size_t ulSize,
+                             void *pvContext) {
+  assert(pvBlock != NULL);
+  (void) pvContext;
+  return realloc(pvBlock, ulSize);
+}
+
+static void countingFree(void *pvBlock, void *pvContext) {
+  if (pvBlock != NULL)
+    (*(long *) pvContext)--;
+  free(pvBlock);
+}
+
+/* The state of a failing allocator: the number of blocks handed out
+   and not given back, and the number of reallocations that succeed
+   before one fails, or a negative number if none fails. */
+struct failingState {
+  long lLiveBlocks;
+  long lReallocsLeft;
+};
+
+/* An allocator that counts blocks as the counting allocator does, in
+   the struct failingState at pvContext, but fails one reallocation. */
+static void *failingAlloc(size_t ulSize, void *pvContext) {
+  void *pvBlock = malloc(ulSize);
+  if (pvBlock != NULL)
+    ((struct failingState *) pvContext)->lLiveBlocks++;
+  return pvBlock;
+}
+
+static void *failingRealloc(void *pvBlock, size_t ulSize,
+                            void *pvContext) {
+  struct failingState *psState = (struct failingState *) pvContext;
+  assert(pvBlock != NULL);
+  if (psState->lReallocsLeft >= 0 && psState->lReallocsLeft-- == 0)
+    return NULL;
+  return realloc(pvBlock, ulSize);
+}
+
+static void failingFree(void *pvBlock, void *pvContext) {
+  if (pvBlock != NULL)
+    ((struct failingState *) pvContext)->lLiveBlocks--;
+  free(pvBlock);
+}
+
+/* A block of an arena, followed by the memory handed out in it,
+   suitably aligned for any type. */
+union arenaBlock {
+  struct {
+    /* the block handed out before this one, or NULL */
+    union arenaBlock *psPrev;
+    /* the number of bytes handed out */
+    size_t ulSize;
+  } sHeader;
+  long double ldAlign;
+  void *pvAlign;
+};
+
+/* An arena allocator, which releases nothing until arenaRelease
+   releases every block in *pvContext, a union arenaBlock pointer, at
+   once. */
+static void *arenaAlloc(size_t ulSize, void *pvContext) {
+  union arenaBlock **ppsLast = (union arenaBlock **) pvContext;
+  union arenaBlock *psBlock;
+
+  psBlock = malloc(sizeof(union arenaBlock) + ulSize);
+  if (psBlock == NULL)
+    return NULL;
+  psBlock->sHeader.psPrev = *ppsLast;
+  psBlock->sHeader.ulSize = ulSize;
+  *ppsLast = psBlock;
+  return psBlock + 1;
+}
+
+static void *arenaRealloc(void *pvBlock, size_t ulSize,
+                          void *pvContext) {
+  union arenaBlock *psOld = (union arenaBlock *) pvBlock - 1;
+  void *pvNew;
+
+  pvNew = arenaAlloc(ulSize, pvContext);
+  if (pvNew != NULL)
+    memcpy(pvNew, pvBlock, (psOld->sHeader.ulSize < ulSize)
+           ? psOld->sHeader.ulSize : ulSize);
+  return pvNew;
+}
+
+static void arenaRelease(union arenaBlock **ppsLast) {
+  union arenaBlock *psBlock;
+
+  while (*ppsLast != NULL) {
+    psBlock = *ppsLast;
+    *ppsLast = psBlock->sHeader.psPrev;
+    free(psBlock);
+  }
+}
+
+/* Builds and takes apart a small FT, with enough siblings in one
+   directory for it to use a B+-tree, and destroys it, leaving FT
+   uninitialized. */
+static void exerciseFT(void) {
+  enum {NUM_CHILDREN = 1000};
+  char acPath[32];
+  char *pcString;
+  size_t i;
+  size_t ulFreed;
+
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDir("1root/2child/3gkid") == SUCCESS);
+  assert(FT_insertFile("1root/2child/3gfile", "data",
+                       strlen("data")+1) == SUCCESS);
+  for (i = 0; i < NUM_CHILDREN; i++) {
+    sprintf(acPath, "1root/2many/c%lu", (unsigned long) i);
+    assert(FT_insertDir(acPath) == SUCCESS);
+  }
+  for (i = 0; i < NUM_CHILDREN; i += 2) {
+    sprintf(acPath, "1root/2many/c%lu", (unsigned long) i);
+    assert(FT_rmDir(acPath) == SUCCESS);
+  }
+  assert(FT_rmDir("1root/2child/3gkid") == SUCCESS);
+  assert(FT_trim(&ulFreed) == SUCCESS);
+  assert((pcString = FT_toString()) != NULL);
+  free(pcString);
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Fills a directory with children, removes most of them, and trims
+   the FT with an allocator whose reallocation number lFailure fails,
+   so that each array that FT_trim shrinks is in turn left at its old
+   size. Then checks that the FT still works, and takes in new names,
+   and that every block is given back after FT_destroy. */
+static void exerciseTrimFailure(long lFailure) {
+  enum {NUM_CHILDREN = 1000, KEPT_CHILDREN = 50};
+  struct failingState sState;
+  char acPath[32];
+  size_t i;
+  size_t ulFreed;
+
+  sState.lLiveBlocks = 0;
+  sState.lReallocsLeft = -1;
+  assert(FT_setAllocator(failingAlloc, failingRealloc, failingFree,
+                         &sState) == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  for (i = 0; i < NUM_CHILDREN; i++) {
+    sprintf(acPath, "1root/old%lu", (unsigned long) i);
+    assert(FT_insertDir(acPath) == SUCCESS);
+  }
+  for (i = KEPT_CHILDREN; i < NUM_CHILDREN; i++) {
+    sprintf(acPath, "1root/old%lu", (unsigned long) i);
+    assert(FT_rmDir(acPath) == SUCCESS);
+  }
+
+  sState.lReallocsLeft = lFailure;
+  assert(FT_trim(&ulFreed) == SUCCESS);
+  sState.lReallocsLeft = -1;
+
+  for (i = 0; i < NUM_CHILDREN; i++) {
+    sprintf(acPath, "1root/new%lu", (unsigned long) i);
+    assert(FT_insertDir(acPath) == SUCCESS);
+  }
+  for (i = 0; i < NUM_CHILDREN; i++) {
+    sprintf(acPath, "1root/old%lu", (unsigned long) i);
+    assert(FT_containsDir(acPath) == (i < KEPT_CHILDREN));
+    sprintf(acPath, "1root/new%lu", (unsigned long) i);
+    assert(FT_containsDir(acPath) == TRUE);
+  }
+  assert(FT_destroy() == SUCCESS);
+  assert(sState.lLiveBlocks == 0);
+  assert(FT_setAllocator(NULL, NULL, NULL, NULL) == SUCCESS);
+}
+
+/* Runs exerciseFT under a counting allocator, checking that every
+   block is given back, and then under an arena allocator, which
+   FT_destroy leaves to the client to release. */
+static void testAllocators(void) {
+  long lLiveBlocks = 0;
+  union arenaBlock *psArena = NULL;
+  long lFailure;
+
+  assert(FT_setAllocator(countingAlloc, countingRealloc, countingFree,
+                         &lLiveBlocks) == SUCCESS);
+  exerciseFT();
+  assert(lLiveBlocks == 0);
+
+  assert(FT_setAllocator(arenaAlloc, arenaRealloc, NULL,
+                         &psArena) == SUCCESS);
+  exerciseFT();
+  assert(psArena != NULL);
+  arenaRelease(&psArena);
+
+  assert(FT_setAllocator(NULL, NULL, NULL, NULL) == SUCCESS);
+
+  /* FT_trim makes only a few reallocations, so failing each of the
+     first several in turn covers them all */
+  for (lFailure = 0; lFailure < 8; lFailure++)
+    exerciseTrimFailure(lFailure);
+}
+
 /* Tests the FT implementation with an assortment of checks.
    Prints the status of the data structure along the way to stderr.
    Returns 0. */
 int main(void) {
   enum {ARRLEN = 1000};
   char* temp;
+  char* trimmed;
   boolean bIsFile;
   size_t l;
   char arr[ARRLEN];
   arr[0] = '\0';
 
   /* Before the data structure is initialized:
-     * insert*, rm*, and destroy should all return INITIALIZATION_ERROR
+     * insert*, rm*, trim, and destroy should all return
+       INITIALIZATION_ERROR
      * contains* should return FALSE
      * toString should return NULL.
   */
@@ -34,13 +357,22 @@ int main(void) {
   assert(FT_containsFile("1root/2child/3gkid/4ggk") == FALSE);
   assert(FT_rmFile("1root/2child/3gkid/4ggk") == INITIALIZATION_ERROR);
   assert((temp = FT_toString()) == NULL);
+  assert(FT_trim(&l) == INITIALIZATION_ERROR);
   assert(FT_destroy() == INITIALIZATION_ERROR);
 
+  /* The allocator can be chosen only before initialization. */
+  assert(FT_setAllocator(NULL, NULL, NULL, NULL) == SUCCESS);
+
   /* After initialization, the data structure is empty, so
      contains* should still return FALSE for any non-NULL string,
      and toString should return the empty string.
   */
   assert(FT_init() == SUCCESS);
+  assert(FT_setAllocator(NULL, NULL, NULL, NULL) == INITIALIZATION_ERROR);
+
+  /* Directories with more than two children are indexed, so the
+     lookups below use both binary search and hashing. */
+  FT_setIndexFanout(2);
   assert(FT_containsDir("1root/2child/3gkid") == FALSE);
   assert(FT_containsFile("1root/2child/3gkid/4ggk") == FALSE);
   assert((temp = FT_toString()) != NULL);
@@ -233,6 +565,19 @@ int main(void) {
   assert(FT_insertDir("1root/y/CHILD2DIR/CHILD4DIR") == SUCCESS);
   assert((temp = FT_toString()) != NULL);
   fprintf(stderr, "Checkpoint 4.5:\n%s\n", temp);
+
+  /* trimming releases memory without changing the contents */
+  assert(FT_rmDir("1root/y/CHILD2DIR") == SUCCESS);
+  assert(FT_rmDir("1root/y/CHILD3DIR") == SUCCESS);
+  assert(FT_insertDir("1root/y/CHILD2DIR") == SUCCESS);
+  assert(FT_insertDir("1root/y/CHILD2DIR/CHILD4DIR") == SUCCESS);
+  assert(FT_insertDir("1root/y/CHILD3DIR") == SUCCESS);
+  assert(FT_trim(&l) == SUCCESS);
+  assert(FT_trim(&l) == SUCCESS);
+  assert(l == 0);
+  assert((trimmed = FT_toString()) != NULL);
+  assert(!strcmp(temp, trimmed));
+  free(trimmed);
   free(temp);
 
   assert(FT_destroy() == SUCCESS);
@@ -241,5 +586,13 @@ int main(void) {
   assert(FT_containsFile("1root") == FALSE);
   assert((temp = FT_toString()) == NULL);
 
+  /* A directory with thousands of children keeps them in a B+-tree,
+     which trimming returns to an array once most are removed. */
+  testManySiblings();
+
+  /* Every block that the FT allocates is freed by FT_destroy, unless
+     the allocator releases its memory at once. */
+  testAllocators();
+
   return 0;
 }
@@ -6,57 +6,560 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
-#include "dynarray.h"
+#include "alloc.h"
+#include "dynarraygen.h"
+#include "intern.h"
 #include "node.h"
 
+/* The number of children a directory holds without allocating */
+enum { INLINE_CHILDREN = 4 };
 
-/* A node in a FT (can either be a file or a directory) */
+/* The number of children beyond which a directory keeps them in a
+   B+-tree */
+enum { TREE_CHILDREN = 512 };
+
+/* The most children in each leaf and each branch of such a tree,
+   chosen so that both are 512 bytes, eight 64-byte cache lines, with
+   8-byte pointers and sizes; a search reads a few whole lines of each
+   node it visits rather than one line of each of many nodes */
+enum { CHILD_LEAF_SIZE = 62, CHILD_BRANCH_SIZE = 21 };
+
+/* The number of children at or below which Node_trim returns a
+   directory's children from a tree to an ordinary array. It is well
+   below TREE_CHILDREN so that a directory whose size hovers around
+   that does not convert back and forth. */
+enum { FLAT_CHILDREN = TREE_CHILDREN / 4 };
+
+/* The default number of children beyond which a directory also keeps
+   a hash index of them by name */
+enum { INDEXED_CHILDREN = 64 };
+
+/* The number of children beyond which a directory builds its hash
+   index, as set by Node_setIndexFanout */
+static size_t ulIndexFanout = INDEXED_CHILDREN;
+
+/* A typed dynamic array of nodes, used for each directory's children,
+   whose searches call their comparison functions directly. Most
+   directories are small enough that their children stay inline. */
+DYNARRAY_DEFINE_SMALL(NodeArr, Node_T, INLINE_CHILDREN)
+
+/* A B+-tree of nodes, used instead for the children of large
+   directories, so that adding or removing a child takes logarithmic
+   rather than linear time */
+DYNARRAY_DEFINE_BTREE(NodeTree, Node_T, CHILD_LEAF_SIZE,
+                      CHILD_BRANCH_SIZE)
+
+/* The number of nodes in each slab */
+enum { SLAB_NODES = 256 };
+
+/* A node in a FT (can either be a file or a directory). The fields
+   that searches and path walks read come first, within the node's
+   first 40 bytes, so that comparing a node or climbing through it
+   touches only its first cache line; the children array and the
+   file's contents, which are read only once a node is reached, come
+   last. */
 struct node {
-   /* the object corresponding to the node's absolute path */
-   Path_T oPPath;
-   /* this node's parent */
+   /* the intern table identifier of the path's final component, to
+      which the node holds a reference; the rest of the path is given
+      by the node's ancestors */
+   unsigned int uiName;
+   /* the node's type (file or directory) */
+   boolean isFile;
+   /* this node's parent, or, while the node is free, the next free
+      node */
    Node_T oNParent;
-   /* the object containing links to this node's children */
-   DynArray_T oDChildren;
+   /* the number of components in the node's path, which is one more
+      than its parent's */
+   size_t ulDepth;
+   /* once the node has more than TREE_CHILDREN children, the tree
+      containing them instead (leaving sChildren empty), or NULL until
+      then */
+   NodeTree_T oDTree;
+   /* once the node has more than ulIndexFanout children, a hash index
+      of them by name, or NULL until then */
+   struct nodeIndex *psIndex;
 
-    /* the node's type (file or directory) */
-    boolean isFile;
+   /* the array containing links to this node's children, stored
+      within the node itself */
+   struct NodeArr sChildren;
     /* the file's content */
     void *contents;
     /* the file's content size */
     size_t contentSize;
 };
+
+/* A fixed-size block of nodes. Nodes are handed out from the newest
+   slab in the order they are created, so that nodes created together,
+   such as a directory's children, lie together in memory. */
+struct nodeSlab {
+   /* the next (older) slab, or NULL */
+   struct nodeSlab *psNext;
+   /* the nodes */
+   struct node asNodes[SLAB_NODES];
+};
+
+/*
+  The node allocator is an AO with the following state variables:
+*/
+
+/* 1. the slabs, newest first */
+static struct nodeSlab *psSlabs;
+/* 2. the number of nodes of the newest slab handed out so far */
+static size_t ulSlabUsed;
+/* 3. the freed nodes, linked through their oNParent fields */
+static Node_T oNFreeNodes;
+
+/* An open-addressing hash table of a directory's children, keyed on
+   the intern table identifier of each child's name and probed
+   linearly. It only speeds up lookups: the children array remains the
+   authority on which children exist and in what order. */
+struct nodeIndex {
+   /* the number of slots, a power of two */
+   size_t ulNumSlots;
+   /* the slots, each holding a child or NULL if empty, stored just
+      after this header */
+   Node_T *poNSlots;
+};
+
+/* A component name that need not be a terminated string */
+struct nodeName {
+   /* the name's first character */
+   const char *pcName;
+   /* the name's string length */
+   size_t ulLength;
+};
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns a node's worth of uninitialized memory, reusing the most
+  recently freed node if there is one, or NULL if a new slab is needed
+  and cannot be allocated.
+*/
+static struct node *Node_alloc(void) {
+   struct nodeSlab *psSlab;
+   struct node *psNode;
+
+   if(oNFreeNodes != NULL) {
+      psNode = oNFreeNodes;
+      oNFreeNodes = psNode->oNParent;
+      return psNode;
+   }
+
+   if(psSlabs == NULL || ulSlabUsed == SLAB_NODES) {
+      psSlab = Alloc_malloc(sizeof(struct nodeSlab));
+      if(psSlab == NULL)
+         return NULL;
+      psSlab->psNext = psSlabs;
+      psSlabs = psSlab;
+      ulSlabUsed = 0;
+   }
+   return &psSlabs->asNodes[ulSlabUsed++];
+}
+/*--------------------------------------------------------------------*/
+
+/* Returns psNode, which must no longer be in use, to the free list. */
+static void Node_release(struct node *psNode) {
+   assert(psNode != NULL);
+
+   psNode->oNParent = oNFreeNodes;
+   oNFreeNodes = psNode;
+}
+/*--------------------------------------------------------------------*/
+
+/* Compares the slabs at *ppvSlab1 and *ppvSlab2 by address. */
+static int Node_compareSlabs(const void *ppvSlab1, const void *ppvSlab2) {
+   const char *pcSlab1 = *(const char * const *) ppvSlab1;
+   const char *pcSlab2 = *(const char * const *) ppvSlab2;
+
+   if(pcSlab1 < pcSlab2)
+      return -1;
+   return (int) (pcSlab1 > pcSlab2);
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the index in ppsSorted, the ulSlabs slabs sorted by address,
+  of the slab that contains psNode.
+*/
+static size_t Node_findSlab(struct nodeSlab **ppsSorted, size_t ulSlabs,
+                            const struct node *psNode) {
+   size_t ulLo = 0;
+   size_t ulHi = ulSlabs;
+   size_t ulMid;
+
+   assert(ppsSorted != NULL);
+   assert(psNode != NULL);
+
+   /* finds the last slab that starts at or before psNode */
+   while(ulHi - ulLo > 1) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      if((const char *) psNode < (const char *) ppsSorted[ulMid]->asNodes)
+         ulHi = ulMid;
+      else
+         ulLo = ulMid;
+   }
+   assert(psNode >= ppsSorted[ulLo]->asNodes &&
+          psNode < ppsSorted[ulLo]->asNodes + SLAB_NODES);
+   return ulLo;
+}
+/*--------------------------------------------------------------------*/
+
+/* Returns the child at index ulIndex of oNParent's children array. */
+static Node_T Node_childAt(Node_T oNParent, size_t ulIndex) {
+   assert(oNParent != NULL);
+
+   if(oNParent->oDTree != NULL)
+      return NodeTree_get(oNParent->oDTree, ulIndex);
+   return NodeArr_get(&oNParent->sChildren, ulIndex);
+}
+/*--------------------------------------------------------------------*/
+
+/* Returns the home slot of the name with identifier uiName in a hash
+   index with ulNumSlots slots. */
+static size_t Node_hashName(unsigned int uiName, size_t ulNumSlots) {
+   unsigned long ulHash;
+
+   /* identifiers are handed out consecutively, so scatter them */
+   ulHash = ((unsigned long)uiName * 2654435761UL) & 0xFFFFFFFFUL;
+   ulHash ^= ulHash >> 16;
+   return (size_t)ulHash & (ulNumSlots - 1);
+}
+/*--------------------------------------------------------------------*/
+
+/* Adds oNChild to psIndex, which must have an empty slot. */
+static void Node_indexInsert(struct nodeIndex *psIndex,
+                             Node_T oNChild) {
+   size_t ulSlot;
+
+   assert(psIndex != NULL);
+   assert(oNChild != NULL);
+
+   ulSlot = Node_hashName(oNChild->uiName, psIndex->ulNumSlots);
+   while(psIndex->poNSlots[ulSlot] != NULL)
+      ulSlot = (ulSlot + 1) & (psIndex->ulNumSlots - 1);
+   psIndex->poNSlots[ulSlot] = oNChild;
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the child in psIndex whose name has identifier uiName, or
+  NULL if there is none.
+*/
+static Node_T Node_indexFind(struct nodeIndex *psIndex,
+                             unsigned int uiName) {
+   size_t ulSlot;
+   Node_T oNChild;
+
+   assert(psIndex != NULL);
+
+   ulSlot = Node_hashName(uiName, psIndex->ulNumSlots);
+   while((oNChild = psIndex->poNSlots[ulSlot]) != NULL) {
+      if(oNChild->uiName == uiName)
+         return oNChild;
+      ulSlot = (ulSlot + 1) & (psIndex->ulNumSlots - 1);
+   }
+   return NULL;
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Removes oNChild from psIndex, if present, moving back any later
+  entries of its probe run that could no longer be reached past the
+  emptied slot.
+*/
+static void Node_indexRemove(struct nodeIndex *psIndex,
+                             Node_T oNChild) {
+   size_t ulMask, ulHole, ulNext, ulHome;
+
+   assert(psIndex != NULL);
+   assert(oNChild != NULL);
+
+   ulMask = psIndex->ulNumSlots - 1;
+   ulHole = Node_hashName(oNChild->uiName, psIndex->ulNumSlots);
+   while(psIndex->poNSlots[ulHole] != oNChild) {
+      if(psIndex->poNSlots[ulHole] == NULL)
+         return;
+      ulHole = (ulHole + 1) & ulMask;
+   }
+
+   ulNext = (ulHole + 1) & ulMask;
+   while(psIndex->poNSlots[ulNext] != NULL) {
+      /* an entry may fill the hole only if the hole lies between its
+         home slot and where it is now */
+      ulHome = Node_hashName(psIndex->poNSlots[ulNext]->uiName,
+                             psIndex->ulNumSlots);
+      if(((ulNext - ulHome) & ulMask) >= ((ulNext - ulHole) & ulMask)) {
+         psIndex->poNSlots[ulHole] = psIndex->poNSlots[ulNext];
+         ulHole = ulNext;
+      }
+      ulNext = (ulNext + 1) & ulMask;
+   }
+   psIndex->poNSlots[ulHole] = NULL;
+}
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bytes used by psIndex, which may be NULL. */
+static size_t Node_indexSize(struct nodeIndex *psIndex) {
+   if(psIndex == NULL)
+      return 0;
+   return sizeof(struct nodeIndex)
+      + psIndex->ulNumSlots * sizeof(Node_T);
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Replaces oNParent's hash index, if any, with one of all its children
+  that is at most half full. Returns TRUE if successful, or FALSE if
+  memory could not be allocated, in which case the old index is kept.
+*/
+static boolean Node_buildIndex(Node_T oNParent) {
+   struct nodeIndex *psIndex;
+   size_t ulLength, ulNumSlots, ulIndex;
+
+   assert(oNParent != NULL);
+
+   ulLength = Node_getNumChildren(oNParent);
+   ulNumSlots = 2 * INLINE_CHILDREN;
+   while(ulNumSlots < 2 * (ulLength + 1))
+      ulNumSlots *= 2;
+
+   psIndex = Alloc_malloc(sizeof(struct nodeIndex)
+                          + ulNumSlots * sizeof(Node_T));
+   if(psIndex == NULL)
+      return FALSE;
+   psIndex->ulNumSlots = ulNumSlots;
+   psIndex->poNSlots = (Node_T *)(psIndex + 1);
+   for(ulIndex = 0; ulIndex < ulNumSlots; ulIndex++)
+      psIndex->poNSlots[ulIndex] = NULL;
+
+   for(ulIndex = 0; ulIndex < ulLength; ulIndex++)
+      Node_indexInsert(psIndex, Node_childAt(oNParent, ulIndex));
+
+   Alloc_free(oNParent->psIndex);
+   oNParent->psIndex = psIndex;
+   return TRUE;
+}
 /*--------------------------------------------------------------------*/
 
 /*
   Links new child oNChild into oNParent's children array at index
-  ulIndex. Returns SUCCESS if the new child was added successfully,
+  ulIndex, first moving the children to a tree if there are too many.
+  Also adds it to oNParent's hash index, building or growing that as
+  needed; since lookups fall back to binary search, failing to
+  allocate the index is not an error.
+  Returns SUCCESS if the new child was added successfully,
   or  MEMORY_ERROR if allocation fails adding oNChild to the array.
 */
 static int Node_addChild(Node_T oNParent, Node_T oNChild,
                          size_t ulIndex) {
+   NodeTree_T oDTree;
+   size_t ulLength;
+
    assert(oNParent != NULL);
    assert(oNChild != NULL);
 
-   if(DynArray_addAt(oNParent->oDChildren, ulIndex, oNChild))
-      return SUCCESS;
-   else
+   if(oNParent->oDTree == NULL &&
+      NodeArr_getLength(&oNParent->sChildren) == TREE_CHILDREN) {
+      oDTree = NodeTree_new();
+      if(oDTree == NULL)
+         return MEMORY_ERROR;
+      if(!NodeTree_appendArray(oDTree,
+                               oNParent->sChildren.paElements,
+                               TREE_CHILDREN)) {
+         NodeTree_free(oDTree);
+         return MEMORY_ERROR;
+      }
+      NodeArr_destroy(&oNParent->sChildren);
+      oNParent->oDTree = oDTree;
+   }
+
+   if(oNParent->oDTree != NULL) {
+      if(!NodeTree_addAt(oNParent->oDTree, ulIndex, oNChild))
+         return MEMORY_ERROR;
+   }
+   else if(!NodeArr_addAt(&oNParent->sChildren, ulIndex, oNChild))
       return MEMORY_ERROR;
+
+   ulLength = Node_getNumChildren(oNParent);
+   if(oNParent->psIndex != NULL &&
+      2 * (ulLength + 1) <= oNParent->psIndex->ulNumSlots)
+      Node_indexInsert(oNParent->psIndex, oNChild);
+   else if((oNParent->psIndex != NULL || ulLength > ulIndexFanout) &&
+           !Node_buildIndex(oNParent)) {
+      /* a stale index would miss oNChild, so drop it */
+      Alloc_free(oNParent->psIndex);
+      oNParent->psIndex = NULL;
+   }
+
+   return SUCCESS;
 }
 /*--------------------------------------------------------------------*/
 
 /*
-  Compares the string representation of oNfirst with a string
-  pcSecond representing a node's path.
-  Returns <0, 0, or >0 if oNFirst is "less than", "equal to", or
+  Unlinks and returns the child at index ulIndex of oNParent's
+  children array.
+*/
+static Node_T Node_removeChild(Node_T oNParent, size_t ulIndex) {
+   Node_T oNChild;
+
+   assert(oNParent != NULL);
+
+   if(oNParent->oDTree != NULL)
+      oNChild = NodeTree_removeAt(oNParent->oDTree, ulIndex);
+   else
+      oNChild = NodeArr_removeAt(&oNParent->sChildren, ulIndex);
+
+   if(oNParent->psIndex != NULL)
+      Node_indexRemove(oNParent->psIndex, oNChild);
+   return oNChild;
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Compares the ulLength1 characters at pcFirst with the ulLength2
+  characters at pcSecond lexicographically, as strcmp would if they
+  were terminated strings.
+  Returns <0, 0, or >0 if pcFirst is "less than", "equal to", or
   "greater than" pcSecond, respectively.
 */
-static int Node_compareString(const Node_T oNFirst,
-                                 const char *pcSecond) {
-   assert(oNFirst != NULL);
+static int Node_compareStrings(const char *pcFirst, size_t ulLength1,
+                               const char *pcSecond, size_t ulLength2) {
+   size_t ulMin;
+   int iCompare;
+
+   assert(pcFirst != NULL);
    assert(pcSecond != NULL);
 
-   return Path_compareString(oNFirst->oPPath, pcSecond);
+   if(ulLength1 < ulLength2)
+      ulMin = ulLength1;
+   else
+      ulMin = ulLength2;
+
+   iCompare = memcmp(pcFirst, pcSecond, ulMin);
+   if(iCompare != 0)
+      return iCompare;
+
+   /* a proper prefix sorts first */
+   if(ulLength1 < ulLength2)
+      return -1;
+   return ulLength1 > ulLength2;
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Compares the interned component names with identifiers uiFirst and
+  uiSecond lexicographically, using their known lengths.
+  Returns <0, 0, or >0 if uiFirst is "less than", "equal to", or
+  "greater than" uiSecond, respectively.
+*/
+static int Node_compareNames(unsigned int uiFirst,
+                             unsigned int uiSecond) {
+   /* interned names are equal iff their identifiers are */
+   if(uiFirst == uiSecond)
+      return 0;
+
+   return Node_compareStrings(Intern_getString(uiFirst),
+                              Intern_getLength(uiFirst),
+                              Intern_getString(uiSecond),
+                              Intern_getLength(uiSecond));
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Compares the final component of oNChild's path with the component
+  name whose identifier is *puiName. Since siblings' paths differ only
+  in their final component, this orders siblings the same way as
+  Node_compare does, without walking up to their common parent.
+  Returns <0, 0, or >0 if oNChild is "less than", "equal to", or
+  "greater than" *puiName, respectively.
+*/
+static int Node_compareName(const Node_T oNChild,
+                            const unsigned int *puiName) {
+   assert(oNChild != NULL);
+   assert(puiName != NULL);
+
+   return Node_compareNames(oNChild->uiName, *puiName);
+}
+
+DYNARRAY_DEFINE_BSEARCH(NodeArr, NodeArr_bsearchName,
+                        const unsigned int *, Node_compareName)
+DYNARRAY_DEFINE_BTREE_BSEARCH(NodeTree, NodeTree_bsearchName,
+                              const unsigned int *, Node_compareName)
+/*--------------------------------------------------------------------*/
+
+/*
+  Compares the final component of oNChild's path with the name in
+  *psName, which is not necessarily interned, so that a name can be
+  looked up without adding it to the intern table.
+  Returns <0, 0, or >0 if oNChild is "less than", "equal to", or
+  "greater than" *psName, respectively.
+*/
+static int Node_compareNameString(const Node_T oNChild,
+                                  const struct nodeName *psName) {
+   assert(oNChild != NULL);
+   assert(psName != NULL);
+
+   return Node_compareStrings(Intern_getString(oNChild->uiName),
+                              Intern_getLength(oNChild->uiName),
+                              psName->pcName, psName->ulLength);
+}
+
+DYNARRAY_DEFINE_BSEARCH(NodeArr, NodeArr_bsearchNameString,
+                        const struct nodeName *, Node_compareNameString)
+DYNARRAY_DEFINE_BTREE_BSEARCH(NodeTree, NodeTree_bsearchNameString,
+                              const struct nodeName *,
+                              Node_compareNameString)
+/*--------------------------------------------------------------------*/
+
+/*
+  Binary searches oNParent's children, with the comparison function
+  of the given name, for *puiName or *psName, respectively,
+  as DynArray_bsearch does. If found, sets *pulIndex to the child's
+  index and returns 1; otherwise, sets *pulIndex to the index at which
+  it would be inserted and returns 0.
+*/
+static int Node_searchName(Node_T oNParent, const unsigned int *puiName,
+                           size_t *pulIndex) {
+   assert(oNParent != NULL);
+
+   if(oNParent->oDTree != NULL)
+      return NodeTree_bsearchName(oNParent->oDTree, puiName,
+                                  pulIndex);
+   return NodeArr_bsearchName(&oNParent->sChildren, puiName, pulIndex);
+}
+
+static int Node_searchNameString(Node_T oNParent,
+                                 const struct nodeName *psName,
+                                 size_t *pulIndex) {
+   assert(oNParent != NULL);
+
+   if(oNParent->oDTree != NULL)
+      return NodeTree_bsearchNameString(oNParent->oDTree, psName,
+                                        pulIndex);
+   return NodeArr_bsearchNameString(&oNParent->sChildren, psName,
+                                    pulIndex);
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns TRUE if oNNode's path is the first ulDepth components of
+  oPPath, or FALSE if not. oNNode may be NULL, whose path is empty.
+*/
+static boolean Node_isPrefixOf(Node_T oNNode, Path_T oPPath,
+                               size_t ulDepth) {
+   assert(oPPath != NULL);
+   assert(ulDepth <= Path_getDepth(oPPath));
+
+   /* compare from the deepest component up, where paths that share a
+      long prefix differ soonest */
+   while(ulDepth > 0) {
+      if(oNNode == NULL ||
+         oNNode->uiName != Path_getComponentID(oPPath, ulDepth-1))
+         return FALSE;
+      oNNode = oNNode->oNParent;
+      ulDepth--;
+   }
+   return (boolean) (oNNode == NULL);
 }
 /*--------------------------------------------------------------------*/
 
@@ -64,8 +567,6 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
              boolean isFile, void *contents, size_t contentSize) {
    /* Intialize all arguments */
    struct node *psNew;
-   Path_T oPParentPath = NULL;
-   Path_T oPNewPath = NULL;
    size_t ulParentDepth;
    size_t ulIndex;
    int iStatus;
@@ -73,57 +574,55 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
    assert(oPPath != NULL);
 
    /* allocate space for a new node */
-   psNew = malloc(sizeof(struct node));
+   psNew = Node_alloc();
    if(psNew == NULL) {
       *poNResult = NULL;
       return MEMORY_ERROR;
    }
 
-   /* set the new node's path */
-   iStatus = Path_dup(oPPath, &oPNewPath);
-   if(iStatus != SUCCESS) {
-      free(psNew);
-      *poNResult = NULL;
-      return iStatus;
-   }
-   psNew->oPPath = oPNewPath;
+   /* keep only the path's final component */
+   psNew->uiName = Path_getComponentID(oPPath, Path_getDepth(oPPath)-1);
 
    /* validate and set the new node's parent */
    if(oNParent != NULL) {
-      size_t ulSharedDepth;
-
-      oPParentPath = oNParent->oPPath;
-      ulParentDepth = Path_getDepth(oPParentPath);
-      ulSharedDepth = Path_getSharedPrefixDepth(psNew->oPPath,
-                                                oPParentPath);
-      /* parent must be an ancestor of child */
-      if(ulSharedDepth < ulParentDepth) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+      ulParentDepth = oNParent->ulDepth;
+      /* parent must be an ancestor of child. A parent one level up
+         was found by following oPPath down from the root, so only its
+         own name is compared, keeping each level of an insertion
+         constant-time; any other parent is compared in full to tell
+         a conflict from a missing level. */
+      if(Path_getDepth(oPPath) == ulParentDepth + 1) {
+         if(oNParent->uiName !=
+            Path_getComponentID(oPPath, ulParentDepth-1)) {
+            Node_release(psNew);
+            *poNResult = NULL;
+            return CONFLICTING_PATH;
+         }
+      }
+      else if(ulParentDepth > Path_getDepth(oPPath) ||
+              !Node_isPrefixOf(oNParent, oPPath, ulParentDepth)) {
+         Node_release(psNew);
          *poNResult = NULL;
          return CONFLICTING_PATH;
       }
 
       /* parent must be exactly one level up from child */
-      if(Path_getDepth(psNew->oPPath) != ulParentDepth + 1) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+      if(Path_getDepth(oPPath) != ulParentDepth + 1) {
+         Node_release(psNew);
          *poNResult = NULL;
          return NO_SUCH_PATH;
       }
 
       /* parent must not already have child with this path */
       if(oNParent->isFile == FALSE) {
-         if(Node_hasChild(oNParent, oPPath, &ulIndex)) {
-            Path_free(psNew->oPPath);
-            free(psNew);
+         if(Node_searchName(oNParent, &psNew->uiName, &ulIndex)) {
+            Node_release(psNew);
             *poNResult = NULL;
             return ALREADY_IN_TREE;
          }
       } 
       else {
-            Path_free(psNew->oPPath);
-            free(psNew);
+            Node_release(psNew);
             *poNResult = NULL;
             return NOT_A_DIRECTORY; 
       }
@@ -132,17 +631,21 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
     else {
       /* new node must be root */
       /* can only create one "level" at a time */
-      if(Path_getDepth(psNew->oPPath) != 1) {
-         Path_free(psNew->oPPath);
-         free(psNew);
+      if(Path_getDepth(oPPath) != 1) {
+         Node_release(psNew);
          *poNResult = NULL;
          return NO_SUCH_PATH;
       }
    }
    psNew->oNParent = oNParent;
+   psNew->ulDepth = (oNParent == NULL) ? 1 : ulParentDepth + 1;
 
    /* initialize the new node */
    psNew->isFile = isFile;
+   /* a directory's (inline) children array needs no allocation */
+   NodeArr_init(&psNew->sChildren);
+   psNew->oDTree = NULL;
+   psNew->psIndex = NULL;
    /* if new node is a file */
    if(psNew->isFile == TRUE) {
       if(contents == NULL) {
@@ -152,17 +655,6 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
       else {
          psNew->contents = contents; 
          psNew->contentSize = contentSize; 
-         psNew->oDChildren = NULL;
-      }
-   }
-    /* if new node is a directory */
-   else {
-      psNew->oDChildren = DynArray_new(0);
-      if(psNew->oDChildren == NULL) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
-         return MEMORY_ERROR;
       }
    }
 
@@ -170,16 +662,17 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
    if(oNParent != NULL) {
       iStatus = Node_addChild(oNParent, psNew, ulIndex);
       if(iStatus != SUCCESS) {
-         Path_free(psNew->oPPath);
          if(psNew->isFile == FALSE) {
-            DynArray_free(psNew->oDChildren); 
+            NodeArr_destroy(&psNew->sChildren); 
          }
-         free(psNew);
+         Node_release(psNew);
          *poNResult = NULL;
          return iStatus;
       }
    }
 
+   /* the node's name outlives the path it came from */
+   Intern_retain(psNew->uiName);
    *poNResult = psNew;
 
    return SUCCESS;
@@ -187,6 +680,7 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
 /*--------------------------------------------------------------------*/
 
 size_t Node_free(Node_T oNNode) {
+   Node_T oNChild;
    size_t ulIndex;
    size_t ulCount = 0;
 
@@ -194,41 +688,89 @@ size_t Node_free(Node_T oNNode) {
 
    /* remove from parent's list */
    if(oNNode->oNParent != NULL) {
-      if(DynArray_bsearch(
-            oNNode->oNParent->oDChildren,
-            oNNode, &ulIndex,
-            (int (*)(const void *, const void *)) Node_compare)
-        )
-         (void) DynArray_removeAt(oNNode->oNParent->oDChildren,
-                                  ulIndex);
+      if(Node_searchName(oNNode->oNParent, &oNNode->uiName, &ulIndex))
+         (void) Node_removeChild(oNNode->oNParent, ulIndex);
    }
 
-   /* recursively remove children */
+   /* recursively remove children, detaching each one first so that
+      it does not search for and unlink itself, then drop the whole
+      children array at once */
    if (oNNode->isFile == FALSE) {
-        while(DynArray_getLength(oNNode->oDChildren) != 0) {
-            ulCount += Node_free(DynArray_get(oNNode->oDChildren, 0));
+        for(ulIndex = 0; ulIndex < Node_getNumChildren(oNNode);
+            ulIndex++) {
+            oNChild = Node_childAt(oNNode, ulIndex);
+            oNChild->oNParent = NULL;
+            ulCount += Node_free(oNChild);
         }
-        DynArray_free(oNNode->oDChildren);
+        NodeArr_destroy(&oNNode->sChildren);
+        if(oNNode->oDTree != NULL)
+           NodeTree_free(oNNode->oDTree);
+        Alloc_free(oNNode->psIndex);
    }
-   
-   /* remove path */
-   Path_free(oNNode->oPPath);
 
-   /* finally, free the struct node */
-   free(oNNode);
+   /* finally, free the name and the struct node */
+   Intern_release(oNNode->uiName);
+   Node_release(oNNode);
    ulCount++;
    return ulCount;
 }
 /*--------------------------------------------------------------------*/
 
-Path_T Node_getPath(Node_T oNNode) {
+unsigned int Node_getName(Node_T oNNode) {
    assert(oNNode != NULL);
 
-   return oNNode->oPPath;
+   return oNNode->uiName;
 }
+/*--------------------------------------------------------------------*/
+
+size_t Node_getDepth(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return oNNode->ulDepth;
+}
+/*--------------------------------------------------------------------*/
+
+size_t Node_getPathLength(Node_T oNNode) {
+   size_t ulLength = 0;
+
+   assert(oNNode != NULL);
+
+   /* each component plus the '/' before it, except the root's */
+   for(; oNNode != NULL; oNNode = oNNode->oNParent)
+      ulLength += Intern_getLength(oNNode->uiName) + 1;
+   return ulLength - 1;
+}
+/*--------------------------------------------------------------------*/
+
+size_t Node_writePath(Node_T oNNode, char *pcBuffer) {
+   size_t ulLength, ulName;
+   char *pcEnd;
+
+   assert(oNNode != NULL);
+   assert(pcBuffer != NULL);
+
+   /* the components are found deepest first, so fill from the end */
+   ulLength = Node_getPathLength(oNNode);
+   pcEnd = pcBuffer + ulLength;
+   *pcEnd = '\0';
+   for(;;) {
+      ulName = Intern_getLength(oNNode->uiName);
+      pcEnd -= ulName;
+      memcpy(pcEnd, Intern_getString(oNNode->uiName), ulName);
+      oNNode = oNNode->oNParent;
+      if(oNNode == NULL)
+         break;
+      *--pcEnd = '/';
+   }
+   return ulLength;
+}
+/*--------------------------------------------------------------------*/
 
 boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
                          size_t *pulChildID) {
+   size_t ulDepth;
+   unsigned int uiName;
+
    assert(oNParent != NULL);
    assert(oPPath != NULL);
    assert(pulChildID != NULL);
@@ -238,10 +780,68 @@ boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
       return FALSE; 
    }
    
-   /* *pulChildID is the index into oNParent->oDChildren */
-   return DynArray_bsearch(oNParent->oDChildren,
-            (char*) Path_getPathname(oPPath), pulChildID,
-            (int (*)(const void*,const void*)) Node_compareString);
+   /* *pulChildID is the index into oNParent->sChildren. Children are
+      found by their final component, so a path that is not below
+      oNParent is reported at its final component's place. */
+   ulDepth = Path_getDepth(oPPath);
+   uiName = Path_getComponentID(oPPath, ulDepth-1);
+   if(!Node_searchName(oNParent, &uiName, pulChildID))
+      return FALSE;
+
+   return (boolean) (ulDepth == Node_getDepth(oNParent) + 1 &&
+                     Node_isPrefixOf(oNParent, oPPath, ulDepth-1));
+}
+/*--------------------------------------------------------------------*/
+
+boolean Node_findChildID(Node_T oNParent, unsigned int uiName,
+                         Node_T *poNResult) {
+   size_t ulIndex;
+
+   assert(oNParent != NULL);
+   assert(poNResult != NULL);
+
+   if(oNParent->isFile == TRUE)
+      return FALSE;
+
+   if(oNParent->psIndex != NULL) {
+      *poNResult = Node_indexFind(oNParent->psIndex, uiName);
+      return (boolean) (*poNResult != NULL);
+   }
+
+   if(!Node_searchName(oNParent, &uiName, &ulIndex))
+      return FALSE;
+   *poNResult = Node_childAt(oNParent, ulIndex);
+   return TRUE;
+}
+/*--------------------------------------------------------------------*/
+
+boolean Node_findChildNamed(Node_T oNParent, const char *pcName,
+                            size_t ulLength, Node_T *poNResult) {
+   struct nodeName sName;
+   size_t ulIndex;
+   unsigned int uiName;
+
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+   assert(poNResult != NULL);
+
+   if(oNParent->isFile == TRUE)
+      return FALSE;
+
+   /* a name that was never interned cannot be any child's */
+   if(oNParent->psIndex != NULL) {
+      if(!Intern_find(pcName, ulLength, &uiName))
+         return FALSE;
+      *poNResult = Node_indexFind(oNParent->psIndex, uiName);
+      return (boolean) (*poNResult != NULL);
+   }
+
+   sName.pcName = pcName;
+   sName.ulLength = ulLength;
+   if(!Node_searchNameString(oNParent, &sName, &ulIndex))
+      return FALSE;
+   *poNResult = Node_childAt(oNParent, ulIndex);
+   return TRUE;
 }
 /*--------------------------------------------------------------------*/
 
@@ -253,7 +853,9 @@ size_t Node_getNumChildren(Node_T oNParent) {
       return 0; 
    }
 
-   return DynArray_getLength(oNParent->oDChildren);
+   if(oNParent->oDTree != NULL)
+      return NodeTree_getLength(oNParent->oDTree);
+   return NodeArr_getLength(&oNParent->sChildren);
 }
 /*--------------------------------------------------------------------*/
 
@@ -268,13 +870,13 @@ int Node_getChild(Node_T oNParent, size_t ulChildID,
       return NO_SUCH_PATH; 
    }
    
-   /* ulChildID is the index into oNParent->oDChildren */
+   /* ulChildID is the index into oNParent->sChildren */
    if(ulChildID >= Node_getNumChildren(oNParent)) {
       *poNResult = NULL;
       return NO_SUCH_PATH;
    }
    else {
-      *poNResult = DynArray_get(oNParent->oDChildren, ulChildID);
+      *poNResult = Node_childAt(oNParent, ulChildID);
       return SUCCESS;
    }
 }
@@ -287,10 +889,60 @@ Node_T Node_getParent(Node_T oNNode) {
 }
 
 int Node_compare(Node_T oNFirst, Node_T oNSecond) {
+   Node_T oNA, oNB;
+   size_t ulDepth1, ulDepth2, ulLength1, ulLength2, ulMin;
+   int iCompare, iNext1, iNext2;
+
    assert(oNFirst != NULL);
    assert(oNSecond != NULL);
 
-   return Path_comparePath(oNFirst->oPPath, oNSecond->oPPath);
+   /* bring both to the same depth */
+   ulDepth1 = Node_getDepth(oNFirst);
+   ulDepth2 = Node_getDepth(oNSecond);
+   oNA = oNFirst;
+   oNB = oNSecond;
+   for(ulMin = ulDepth1; ulMin > ulDepth2; ulMin--)
+      oNA = oNA->oNParent;
+   for(ulMin = ulDepth2; ulMin > ulDepth1; ulMin--)
+      oNB = oNB->oNParent;
+
+   /* a path sorts before those below it, as a proper prefix would */
+   if(oNA == oNB) {
+      if(ulDepth1 < ulDepth2)
+         return -1;
+      return ulDepth1 > ulDepth2;
+   }
+
+   /* otherwise the paths first differ in the names of the ancestors
+      just below the deepest common one */
+   while(oNA->oNParent != oNB->oNParent) {
+      oNA = oNA->oNParent;
+      oNB = oNB->oNParent;
+   }
+
+   ulLength1 = Intern_getLength(oNA->uiName);
+   ulLength2 = Intern_getLength(oNB->uiName);
+   if(ulLength1 < ulLength2)
+      ulMin = ulLength1;
+   else
+      ulMin = ulLength2;
+   iCompare = memcmp(Intern_getString(oNA->uiName),
+                     Intern_getString(oNB->uiName), ulMin);
+   if(iCompare != 0 || ulLength1 == ulLength2)
+      return iCompare;
+
+   /* one name is a prefix of the other, so compare the character
+      that follows it in its whole path, a '/' or the terminator,
+      with the other name's next character */
+   if(ulLength1 < ulLength2) {
+      iNext1 = (oNA == oNFirst) ? '\0' : '/';
+      iNext2 = (unsigned char) Intern_getString(oNB->uiName)[ulMin];
+   }
+   else {
+      iNext1 = (unsigned char) Intern_getString(oNA->uiName)[ulMin];
+      iNext2 = (oNB == oNSecond) ? '\0' : '/';
+   }
+   return iNext1 - iNext2;
 }
 /*--------------------------------------------------------------------*/
 
@@ -299,11 +951,11 @@ char *Node_toString(Node_T oNNode) {
 
    assert(oNNode != NULL);
 
-   copyPath = malloc(Path_getStrLength(Node_getPath(oNNode))+1);
+   copyPath = malloc(Node_getPathLength(oNNode)+1);
    if(copyPath == NULL)
       return NULL;
-   else
-      return strcpy(copyPath, Path_getPathname(Node_getPath(oNNode)));
+   (void) Node_writePath(oNNode, copyPath);
+   return copyPath;
 }
 /*--------------------------------------------------------------------*/
 
@@ -350,4 +1002,174 @@ size_t Node_getContentLength(Node_T oNNode) {
    }
 
    return oNNode->contentSize; 
-}
\ No newline at end of file
+}
+/*--------------------------------------------------------------------*/
+
+size_t Node_trimSlabs(void) {
+   struct nodeSlab **ppsSorted;
+   struct nodeSlab **ppsLink;
+   struct nodeSlab *psSlab;
+   size_t *pulFree;
+   size_t ulSlabs = 0;
+   size_t ulReleased = 0;
+   size_t i;
+   Node_T oNNode;
+   Node_T oNNext;
+   Node_T *poNTail;
+
+   /* a bulk allocator cannot take the slabs back one at a time */
+   if(oNFreeNodes == NULL || Alloc_isBulk())
+      return 0;
+
+   for(psSlab = psSlabs; psSlab != NULL; psSlab = psSlab->psNext)
+      ulSlabs++;
+
+   /* the scratch space is given back before returning, so it comes
+      from malloc; without it, nothing is released */
+   ppsSorted = malloc(sizeof(struct nodeSlab *) * ulSlabs);
+   pulFree = calloc(ulSlabs, sizeof(size_t));
+   if(ppsSorted == NULL || pulFree == NULL) {
+      free(ppsSorted);
+      free(pulFree);
+      return 0;
+   }
+
+   /* counts the free nodes of each slab, found by address */
+   i = 0;
+   for(psSlab = psSlabs; psSlab != NULL; psSlab = psSlab->psNext)
+      ppsSorted[i++] = psSlab;
+   qsort(ppsSorted, ulSlabs, sizeof(struct nodeSlab *),
+         Node_compareSlabs);
+   for(oNNode = oNFreeNodes; oNNode != NULL; oNNode = oNNode->oNParent)
+      pulFree[Node_findSlab(ppsSorted, ulSlabs, oNNode)]++;
+
+   /* a slab is released once every node handed out from it is free,
+      which for the newest slab is only its first ulSlabUsed nodes;
+      its count becomes 0 to mark it */
+   for(i = 0; i < ulSlabs; i++) {
+      if(pulFree[i] == ((ppsSorted[i] == psSlabs) ? ulSlabUsed
+                                                  : SLAB_NODES))
+         pulFree[i] = 0;
+      else
+         pulFree[i] = 1;
+   }
+
+   /* drops the released slabs' nodes from the free list, keeping the
+      others in the same order */
+   poNTail = &oNFreeNodes;
+   for(oNNode = oNFreeNodes; oNNode != NULL; oNNode = oNNext) {
+      oNNext = oNNode->oNParent;
+      if(pulFree[Node_findSlab(ppsSorted, ulSlabs, oNNode)] != 0) {
+         *poNTail = oNNode;
+         poNTail = &oNNode->oNParent;
+      }
+   }
+   *poNTail = NULL;
+
+   /* and then the slabs themselves; every slab older than the newest
+      is full, so if the newest goes, the next is entirely handed out */
+   ppsLink = &psSlabs;
+   while(*ppsLink != NULL) {
+      psSlab = *ppsLink;
+      i = Node_findSlab(ppsSorted, ulSlabs, psSlab->asNodes);
+      if(pulFree[i] == 0) {
+         if(psSlab == psSlabs)
+            ulSlabUsed = SLAB_NODES;
+         *ppsLink = psSlab->psNext;
+         Alloc_free(psSlab);
+         ulReleased++;
+      }
+      else
+         ppsLink = &psSlab->psNext;
+   }
+
+   free(ppsSorted);
+   free(pulFree);
+   return ulReleased * sizeof(struct nodeSlab);
+}
+/*--------------------------------------------------------------------*/
+
+void Node_releaseAll(void) {
+   struct nodeSlab *psSlab;
+
+   while(psSlabs != NULL) {
+      psSlab = psSlabs;
+      psSlabs = psSlab->psNext;
+      Alloc_free(psSlab);
+   }
+   ulSlabUsed = 0;
+   oNFreeNodes = NULL;
+}
+/*--------------------------------------------------------------------*/
+
+void Node_setIndexFanout(size_t ulFanout) {
+   ulIndexFanout = ulFanout;
+}
+/*--------------------------------------------------------------------*/
+
+/*
+  Drops oNNode's hash index once it has at most half as many children
+  as would build one, or otherwise rebuilds an index that has become
+  mostly empty at its proper size. Returns the number of bytes
+  released.
+*/
+static size_t Node_trimIndex(Node_T oNNode) {
+   size_t ulLength, ulOldSize;
+
+   assert(oNNode != NULL);
+
+   if(oNNode->psIndex == NULL)
+      return 0;
+
+   ulOldSize = Node_indexSize(oNNode->psIndex);
+   ulLength = Node_getNumChildren(oNNode);
+   if(ulLength <= ulIndexFanout / 2) {
+      Alloc_free(oNNode->psIndex);
+      oNNode->psIndex = NULL;
+      return ulOldSize;
+   }
+
+   if(8 * ulLength < oNNode->psIndex->ulNumSlots &&
+      Node_buildIndex(oNNode))
+      return ulOldSize - Node_indexSize(oNNode->psIndex);
+   return 0;
+}
+/*--------------------------------------------------------------------*/
+
+size_t Node_trim(Node_T oNNode) {
+   size_t ulLength;
+   size_t ulIndex;
+   size_t ulFreed;
+
+   assert(oNNode != NULL);
+
+   if(oNNode->isFile == TRUE)
+      return 0;
+
+   ulFreed = Node_trimIndex(oNNode);
+
+   if(oNNode->oDTree == NULL)
+      return ulFreed + NodeArr_shrink(&oNNode->sChildren);
+
+   ulLength = NodeTree_getLength(oNNode->oDTree);
+   if(ulLength > FLAT_CHILDREN)
+      return ulFreed + NodeTree_shrink(oNNode->oDTree);
+
+   /* few enough children remain to go back to an ordinary array;
+      sChildren is empty while they are in a tree, so once it has room
+      for them, adding them cannot fail */
+   if(ulLength > INLINE_CHILDREN &&
+      !NodeArr_reserve(&oNNode->sChildren, ulLength))
+      return ulFreed + NodeTree_shrink(oNNode->oDTree);
+   for(ulIndex = 0; ulIndex < ulLength; ulIndex++)
+      (void) NodeArr_add(&oNNode->sChildren,
+                         NodeTree_get(oNNode->oDTree, ulIndex));
+
+   ulFreed += NodeTree_getSize(oNNode->oDTree);
+   NodeTree_free(oNNode->oDTree);
+   oNNode->oDTree = NULL;
+
+   if(oNNode->sChildren.paElements != oNNode->sChildren.aInline)
+      ulFreed -= sizeof(Node_T) * oNNode->sChildren.uPhysLength;
+   return ulFreed;
+}
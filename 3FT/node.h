@@ -23,7 +23,11 @@ typedef struct node *Node_T;
   if successful. Otherwise, sets *poNResult to NULL and returns 
   status:
   * MEMORY_ERROR if memory could not be allocated to complete request
-  * CONFLICTING_PATH if oNParent's path is not an ancestor of oPPath
+  * CONFLICTING_PATH if oNParent's path is not an ancestor of oPPath;
+                     if oPPath is one level below oNParent, only
+                     oNParent's own name is compared, so oNParent
+                     must have been found by following oPPath from
+                     the root
   * NO_SUCH_PATH if oPPath is of depth 0
                  or oNParent's path is not oPPath's direct parent
                  or oNParent is NULL but oPPath is not of depth 1
@@ -39,21 +43,60 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
 */
 size_t Node_free(Node_T oNNode);
 
-/* Returns the path object representing oNNode's absolute path. */
-Path_T Node_getPath(Node_T oNNode);
+/*
+  Returns the intern table identifier of the final component of
+  oNNode's path. A node keeps only this component; the rest of its
+  path is given by its ancestors.
+*/
+unsigned int Node_getName(Node_T oNNode);
+
+/* Returns the number of components in oNNode's path. */
+size_t Node_getDepth(Node_T oNNode);
+
+/* Returns the string length of oNNode's absolute path. */
+size_t Node_getPathLength(Node_T oNNode);
+
+/*
+  Writes oNNode's absolute path, '\0'-terminated, to pcBuffer, which
+  must have room for Node_getPathLength(oNNode) + 1 characters, and
+  returns its string length. The path is rebuilt from the node's
+  ancestors each time.
+*/
+size_t Node_writePath(Node_T oNNode, char *pcBuffer);
 
 /*
   Returns TRUE if oNParent has a child with path oPPath. Returns
   FALSE if it does not.
 
   If oNParent has such a child, stores in *pulChildID the child's
-  identifier (as used in Node_getChild). If oNParent does not have
-  such a child, stores in *pulChildID the identifier that such a
-  child _would_ have if inserted.
+  identifier (as used in Node_getChild). Otherwise, stores in
+  *pulChildID the identifier of oNParent's child whose name is oPPath's
+  final component, if there is one, or else the identifier that such
+  a child _would_ have if inserted.
 */
 boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
                          size_t *pulChildID);
 
+/*
+  Returns TRUE and sets *poNResult to oNParent's child whose path's
+  final component has intern table identifier uiName, if it has one.
+  Otherwise, leaves *poNResult unchanged and returns FALSE. Unlike
+  Node_hasChild, this does not report the child's identifier, so it
+  takes constant expected time for a directory with a hash index (see
+  Node_setIndexFanout).
+*/
+boolean Node_findChildID(Node_T oNParent, unsigned int uiName,
+                         Node_T *poNResult);
+
+/*
+  Returns TRUE and sets *poNResult to oNParent's child whose path's
+  final component is the ulLength characters at pcName, which need
+  not be terminated. Otherwise, leaves *poNResult unchanged and
+  returns FALSE. Allocates no memory.
+*/
+boolean Node_findChildNamed(Node_T oNParent, const char *pcName,
+                            size_t ulLength, Node_T *poNResult);
+
 /* Returns the number of children that oNParent has. */
 size_t Node_getNumChildren(Node_T oNParent);
 
@@ -62,6 +105,9 @@ size_t Node_getNumChildren(Node_T oNParent);
   node of oNParent with identifier ulChildID, if one exists.
   Otherwise, sets *poNResult to NULL and returns status:
   * NO_SUCH_PATH if ulChildID is not a valid child for oNParent
+  For a large directory this remembers where the child was found, so
+  that getting the children in order is fast, and thus must not be
+  called on one directory by two threads at once.
 */
 int Node_getChild(Node_T oNParent, size_t ulChildID,
                   Node_T *poNResult);
@@ -107,4 +153,41 @@ void * Node_getFileContents(Node_T oNNode);
 /* Returns content size of oNNode if oNNode is a file, or 0 if oNNode is a directory. */
 size_t Node_getContentLength(Node_T oNNode);
 
+/*
+  Releases memory that oNNode's children array has outgrown, such as
+  after many of its children were removed, and returns the number of
+  bytes released (0 if oNNode is a file). Only an array that has
+  become mostly empty is shrunk, so that one that shrinks and grows
+  again is not reallocated each time.
+*/
+size_t Node_trim(Node_T oNNode);
+
+/*
+  Releases each block of node memory all of whose nodes have been
+  freed with Node_free, and returns the number of bytes released.
+  Nodes are allocated in blocks of a few hundred, so a block is
+  released only once no node from it remains, as after a whole
+  subtree was removed. Releases nothing if the allocator set with
+  Alloc_set releases all of its memory at once.
+*/
+size_t Node_trimSlabs(void);
+
+/*
+  Releases the memory of every node at once, including that of nodes
+  still in a tree, which become invalid without their children
+  arrays being freed. Call this once the tree has been freed
+  with Node_free, or when the allocator set with Alloc_set releases
+  all of its memory at once.
+*/
+void Node_releaseAll(void);
+
+/*
+  Makes each directory keep a hash index of its children by name once
+  it has more than ulFanout children, in addition to its sorted array
+  of them, so that Node_findChildID and Node_findChildNamed need not
+  binary search. A directory builds its index when a child is next
+  added to it, and Node_trim drops one that no longer pays its way.
+*/
+void Node_setIndexFanout(size_t ulFanout);
+
 #endif
@@ -0,0 +1 @@
+../0shared/path_client.c
\ No newline at end of file